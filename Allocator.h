@@ -6,70 +6,363 @@
 
 #include <utility>
 #include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <bit>
+#include <type_traits>
 
+#include "ChunkSource.h"
+#include "Debug.h"
+#include "Profiler.h"
+#include "RemoteFreeList.h"
 
-template <typename T>
+
+//回收时检查指针是否属于某个 chunk，默认仅在调试构建中开启
+#ifndef ALLOCATOR_CHECK_OWNERSHIP
+#ifdef NDEBUG
+#define ALLOCATOR_CHECK_OWNERSHIP 0
+#else
+#define ALLOCATOR_CHECK_OWNERSHIP 1
+#endif
+#endif
+
+
+//每个 chunk 的 block 数从 MinBlocksPerChunk 开始按 2 倍增长，直至 MaxBlocksPerChunk
+template <typename T, size_t MinBlocksPerChunk = size_t{ 1 } << 6, size_t MaxBlocksPerChunk = size_t{ 1 } << 16, typename ChunkSource = NewChunkSource>
 class Allocator {
-	static constexpr size_t blocks_per_chunk = size_t{ 1 } << 10;
-
-	struct FreeBlock {
-		std::byte buffer[sizeof(T)];
-		union {
-			void* mask; //用于已分配的内存块
-			FreeBlock* next; //用于未分配的内存块
-		};
+	static_assert(MinBlocksPerChunk >= 2 && MinBlocksPerChunk <= MaxBlocksPerChunk);
+
+	//已分配的 block 只有 T 本身，未分配时其中存放 next；MEMORY_MANAGER_DEBUG 为 1 时 T 之后还有 guard 字节
+	union FreeBlock {
+		alignas(T) std::byte buffer[sizeof(T) + memory_debug::guard_size];
+		FreeBlock* next;
 	};
 
-	struct Chunk {
-		FreeBlock blocks[blocks_per_chunk];
+	//blocks 紧跟在 Chunk 之后
+	struct alignas(FreeBlock) Chunk {
 		Chunk* next;
+		size_t block_count;
 
-		constexpr explicit Chunk(Chunk* next = nullptr) noexcept: next(next) {
-			auto it = blocks;
-			it->mask = it->buffer; //第一个 block 用于分配
-			for (++it; it != blocks + blocks_per_chunk - 1; ++it) {
-				it->next = it + 1;
-			}
-			it->next = nullptr;
+		constexpr Chunk(Chunk* next, size_t block_count) noexcept: next(next), block_count(block_count) {}
+
+		[[nodiscard]] constexpr FreeBlock* blocks() noexcept {
+			return reinterpret_cast<FreeBlock*>(this + 1);
+		}
+
+		[[nodiscard]] static constexpr size_t bytes(size_t block_count) noexcept {
+			return sizeof(Chunk) + block_count * sizeof(FreeBlock);
+		}
+
+		[[nodiscard]] constexpr bool contains(const void* p) noexcept {
+			const auto offset = static_cast<const std::byte*>(p) - reinterpret_cast<const std::byte*>(blocks());
+			return std::less_equal<const void*>{}(blocks(), p) && std::less<const void*>{}(p, blocks() + block_count)
+			       && offset % sizeof(FreeBlock) == 0;
 		}
 	};
 
 	Chunk* chunk_head{};
 	FreeBlock* free_block_head{};
+	size_t free_block_count{};
+	size_t next_block_count{ MinBlocksPerChunk };
+	size_t trim_threshold{ std::numeric_limits<size_t>::max() };
+	size_t next_trim{ std::numeric_limits<size_t>::max() };
+	RemoteFreeList remote_free_list; //其他线程回收的 block，空闲链表为空时才取回
+	[[no_unique_address]] ChunkSource chunk_source{};
+	//与 MemoryPool 相同，抽样的表不经过全局 operator new
+	[[no_unique_address]] HeapProfiler<std::conditional_t<std::is_empty_v<ChunkSource>, ChunkSource, NewChunkSource>> profiler{};
 
 public:
 	constexpr Allocator() noexcept = default;
+
+	constexpr explicit Allocator(const ChunkSource& chunk_source) noexcept: chunk_source(chunk_source) {}
+
 	Allocator(const Allocator&) = delete;
 	Allocator& operator=(const Allocator&) = delete;
 
 	constexpr ~Allocator() noexcept {
 		while (chunk_head) {
-			delete[] std::exchange(chunk_head, chunk_head->next);
+			const auto chunk = std::exchange(chunk_head, chunk_head->next);
+			if constexpr (memory_debug::enabled) {
+				memory_debug::unpoison(chunk, Chunk::bytes(chunk->block_count));
+			}
+			chunk_source.deallocate(chunk, Chunk::bytes(chunk->block_count), alignof(Chunk));
 		}
 	}
 
 	[[nodiscard]] constexpr T* allocate() {
+		if (free_block_head == nullptr) {
+			DrainRemote();
+		}
+		FreeBlock* block;
 		if (free_block_head) {
-			const auto next_block = free_block_head->next;
-			free_block_head->mask = free_block_head->buffer;
-			return reinterpret_cast<T*>(std::exchange(free_block_head, next_block));
+			--free_block_count;
+			block = std::exchange(free_block_head, free_block_head->next);
+		} else {
+			const auto chunk = NewChunk(1);
+			LinkBlocks(chunk->blocks() + 1, chunk->blocks() + chunk->block_count); //第一个 block 用于分配
+			block = chunk->blocks();
+		}
+		profiler.on_allocate(block, sizeof(T));
+		return Take(block);
+	}
+
+	//先取下空闲链表中的一段，不足的部分直接从新 chunk 中连续切出
+	constexpr void allocate_n(size_t count, T** out) {
+		for (; count != 0 && free_block_head != nullptr; --count) {
+			profiler.on_allocate(free_block_head, sizeof(T));
+			*out++ = Take(std::exchange(free_block_head, free_block_head->next));
+			--free_block_count;
+			if (free_block_head == nullptr && count != 1) {
+				DrainRemote();
+			}
 		}
 
-		chunk_head = new Chunk{ chunk_head };
-		free_block_head = chunk_head->blocks + 1;
-		return reinterpret_cast<T*>(chunk_head->blocks);
+		while (count != 0) {
+			const auto chunk = NewChunk(count);
+			const auto n = std::min(count, chunk->block_count);
+			auto block = chunk->blocks();
+			for (const auto last = block + n; block != last; ++block) {
+				profiler.on_allocate(block, sizeof(T));
+				*out++ = Take(block);
+			}
+			LinkBlocks(block, chunk->blocks() + chunk->block_count);
+			count -= n;
+		}
 	}
 
 	constexpr void deallocate(T* p) {
-		const auto block = reinterpret_cast<FreeBlock*>(p);
-		if (block->mask != p) {
+#if ALLOCATOR_CHECK_OWNERSHIP
+		if (!Owns(p)) {
 			throw std::runtime_error("The pointer is not allocated from here.");
 		}
+#endif
 
+		profiler.on_deallocate(p);
+		const auto block = Give(p);
 		block->next = free_block_head;
 		free_block_head = block;
+		if (++free_block_count >= next_trim) {
+			trim();
+		}
+	}
+
+	//可在任意线程调用，与所有者的其他操作并发；block 在所有者下次空闲链表为空时才被复用
+	void deallocate_remote(T* p) noexcept {
+		remote_free_list.push(Give(p));
+	}
+
+	//先将这些 block 串成一段，再整段挂到空闲链表头部
+	constexpr void deallocate_n(std::span<T* const> ps) {
+		if (ps.empty()) {
+			return;
+		}
+
+#if ALLOCATOR_CHECK_OWNERSHIP
+		for (const auto p : ps) {
+			if (!Owns(p)) {
+				throw std::runtime_error("The pointer is not allocated from here.");
+			}
+		}
+#endif
+
+		for (const auto p : ps) {
+			profiler.on_deallocate(p);
+		}
+		for (auto it = ps.begin(); it != ps.end() - 1; ++it) {
+			Give(*it)->next = reinterpret_cast<FreeBlock*>(*(it + 1));
+		}
+		Give(ps.back())->next = free_block_head;
+		free_block_head = reinterpret_cast<FreeBlock*>(ps.front());
+		if ((free_block_count += ps.size()) >= next_trim) {
+			trim();
+		}
 	}
 
+	//按地址原地排序 chunk 链表与空闲链表，再同时顺序扫描：完全空闲的 chunk 的 block 恰好是空闲链表中连续的一段，将其摘除并把 chunk 归还 ChunkSource，返回归还的字节数
+	//与 MemoryPool::trim 相同不分配内存，用作进程的 malloc 时也不调用全局 operator new
+	constexpr size_t trim() noexcept {
+		DrainRemote();
+		chunk_head = Sort(chunk_head);
+		free_block_head = Sort(free_block_head);
+
+		size_t released = 0;
+		auto block_link = &free_block_head;
+		for (auto link = &chunk_head; *link != nullptr;) {
+			const auto chunk = *link;
+			const auto begin = chunk->blocks();
+			const auto end = begin + chunk->block_count;
+			//跳过属于之前保留的 chunk 的 block
+			while (*block_link != nullptr && std::less<const void*>{}(*block_link, begin)) {
+				block_link = &(*block_link)->next;
+			}
+			auto it = *block_link;
+			size_t n = 0;
+			for (; it != nullptr && std::less<const void*>{}(it, end); it = it->next) {
+				++n;
+			}
+
+			if (n == chunk->block_count) {
+				*block_link = it;
+				*link = chunk->next;
+				free_block_count -= n;
+				released += Chunk::bytes(chunk->block_count);
+				if constexpr (memory_debug::enabled) {
+					memory_debug::unpoison(chunk, Chunk::bytes(chunk->block_count));
+				}
+				chunk_source.deallocate(chunk, Chunk::bytes(chunk->block_count), alignof(Chunk));
+			} else {
+				link = &chunk->next;
+			}
+		}
+
+		if (trim_threshold != std::numeric_limits<size_t>::max()) {
+			next_trim = free_block_count + trim_threshold;
+		}
+		return released;
+	}
+
+	//空闲 block 数比上次 trim 之后增长 threshold 时自动 trim，默认不自动 trim
+	constexpr void set_trim_threshold(size_t threshold) noexcept {
+		trim_threshold = threshold;
+		next_trim = threshold == std::numeric_limits<size_t>::max() ? threshold : free_block_count + threshold;
+	}
+
+	//见 MemoryPool::set_sample_period 与 MemoryPool::write_heap_profile
+	constexpr void set_sample_period(size_t bytes) noexcept {
+		profiler.set_sample_period(bytes);
+	}
+
+	constexpr bool write_heap_profile(int fd) const noexcept {
+		return profiler.write_heap_profile(fd);
+	}
+
+private:
+	//新 chunk 至少有 min_block_count 个 block，之后的 chunk 大小翻倍
+	[[nodiscard]] constexpr Chunk* NewChunk(size_t min_block_count) {
+		const auto block_count = std::max(next_block_count, std::min(std::bit_ceil(min_block_count), MaxBlocksPerChunk));
+		next_block_count = std::min(next_block_count * 2, MaxBlocksPerChunk);
+		const auto buffer = chunk_source.allocate(Chunk::bytes(block_count), alignof(Chunk));
+		chunk_head = new(buffer) Chunk{ chunk_head, block_count };
+		if constexpr (memory_debug::enabled) {
+			for (auto block = chunk_head->blocks(); block != chunk_head->blocks() + block_count; ++block) {
+				Poison(block);
+			}
+		}
+		return chunk_head;
+	}
+
+	//自底向上的链表归并排序，按地址排序 chunk 链表或空闲链表，不分配内存
+	template <typename Node>
+	[[nodiscard]] static constexpr Node* Sort(Node* head) noexcept {
+		for (size_t width = 1; ; width *= 2) {
+			Node* ret = nullptr;
+			auto tail = &ret;
+			size_t merges = 0;
+			while (head != nullptr) {
+				++merges;
+				auto left = head;
+				auto right = head;
+				for (size_t i = 0; i != width && right != nullptr; ++i) {
+					right = right->next;
+				}
+				auto rest = right;
+				for (size_t i = 0; i != width && rest != nullptr; ++i) {
+					rest = rest->next;
+				}
+
+				//left 与 right 各自最多 width 个，以 right 与 rest 为界
+				const auto left_end = right;
+				const auto right_end = rest;
+				while (left != left_end || right != right_end) {
+					if (right == right_end || (left != left_end && std::less<>{}(left, right))) {
+						*tail = left;
+						left = left->next;
+					} else {
+						*tail = right;
+						right = right->next;
+					}
+					tail = &(*tail)->next;
+				}
+				head = rest;
+			}
+			*tail = nullptr;
+			if (merges <= 1) {
+				return ret;
+			}
+			head = ret;
+		}
+	}
+
+	//MEMORY_MANAGER_DEBUG 为 1 时，空闲 block 中 next 之后的部分填满 freed_byte 并标记为不可访问，next 留给空闲链表读写
+	static void Poison(FreeBlock* block) noexcept {
+		const auto rest = reinterpret_cast<std::byte*>(block) + sizeof(FreeBlock*);
+		memory_debug::fill(rest, sizeof(FreeBlock) - sizeof(FreeBlock*), memory_debug::freed_byte);
+		memory_debug::poison(rest, sizeof(FreeBlock) - sizeof(FreeBlock*));
+	}
+
+	//取出空闲 block 时校验它在空闲期间未被改写，再在 T 之后写入 guard 字节
+	[[nodiscard]] static constexpr T* Take(FreeBlock* block) {
+		if constexpr (memory_debug::enabled) {
+			const auto bytes = reinterpret_cast<std::byte*>(block);
+			memory_debug::unpoison_defined(bytes, sizeof(FreeBlock));
+			memory_debug::check(bytes + sizeof(FreeBlock*), sizeof(FreeBlock) - sizeof(FreeBlock*), memory_debug::freed_byte, "A freed block is modified.");
+			memory_debug::fill(bytes + sizeof(T), sizeof(FreeBlock) - sizeof(T), memory_debug::guard_byte);
+			memory_debug::unpoison(bytes, sizeof(T));
+			memory_debug::poison(bytes + sizeof(T), sizeof(FreeBlock) - sizeof(T));
+		}
+		return reinterpret_cast<T*>(block);
+	}
+
+	//回收时校验 guard 字节，之后整个 block 视为空闲
+	[[nodiscard]] static constexpr FreeBlock* Give(T* p) {
+		const auto block = reinterpret_cast<FreeBlock*>(p);
+		if constexpr (memory_debug::enabled) {
+			const auto bytes = reinterpret_cast<std::byte*>(block);
+			memory_debug::unpoison_defined(bytes + sizeof(T), sizeof(FreeBlock) - sizeof(T));
+			memory_debug::check(bytes + sizeof(T), sizeof(FreeBlock) - sizeof(T), memory_debug::guard_byte, "The block is freed twice or its guard bytes are overwritten.");
+			Poison(block);
+		}
+		return block;
+	}
+
+	constexpr void DrainRemote() noexcept {
+		if (remote_free_list.empty()) {
+			return;
+		}
+		//只写 next，不初始化整个 union
+		free_block_count += remote_free_list.drain([this](void* p) {
+			profiler.on_deallocate(p);
+			const auto block = static_cast<FreeBlock*>(p);
+			block->next = free_block_head;
+			free_block_head = block;
+		});
+	}
+
+	//将 [first, last) 串成链表挂到空闲链表头部
+	constexpr void LinkBlocks(FreeBlock* first, FreeBlock* last) noexcept {
+		if (first == last) {
+			return;
+		}
+		for (auto it = first; it != last - 1; ++it) {
+			it->next = it + 1;
+		}
+		(last - 1)->next = free_block_head;
+		free_block_head = first;
+		free_block_count += last - first;
+	}
+
+	[[nodiscard]] constexpr bool Owns(const void* p) const noexcept {
+		for (auto chunk = chunk_head; chunk != nullptr; chunk = chunk->next) {
+			if (chunk->contains(p)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+public:
 	template <typename U, typename... Args>
 	constexpr void construct(U* p, Args&& ... args) {
 		std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
@@ -0,0 +1,344 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <new>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+
+/*
+ * chunk 的来源，Allocator 与 MemoryPool 通过模板参数选择，需提供：
+ *     void* allocate(size_t size, size_t align);                  失败时抛出 std::bad_alloc
+ *     void deallocate(void* p, size_t size, size_t align) noexcept; 参数与分配时相同
+ * 可选提供：
+ *     void* try_allocate(size_t size, size_t align) noexcept;     失败时返回 nullptr
+ *     void decommit(void* p, size_t size) noexcept;               交还其中整页部分的物理内存，地址仍然可用
+ */
+struct NewChunkSource {
+	[[nodiscard]] void* allocate(size_t size, size_t align) {
+		return operator new(size, std::align_val_t{ align });
+	}
+
+	[[nodiscard]] void* try_allocate(size_t size, size_t align) noexcept {
+		return operator new(size, std::align_val_t{ align }, std::nothrow);
+	}
+
+	void deallocate(void* p, size_t size, size_t align) noexcept {
+		operator delete(p, size, std::align_val_t{ align });
+	}
+};
+
+
+//失败时返回 nullptr：优先调用 try_allocate，否则将 allocate 抛出的异常转为 nullptr
+template <typename ChunkSource>
+[[nodiscard]] constexpr void* TryAllocateChunk(ChunkSource& chunk_source, size_t size, size_t align) noexcept {
+	if constexpr (requires { chunk_source.try_allocate(size, align); }) {
+		return chunk_source.try_allocate(size, align);
+	} else {
+		try {
+			return chunk_source.allocate(size, align);
+		} catch (...) {
+			return nullptr;
+		}
+	}
+}
+
+
+#if __has_include(<sys/mman.h>)
+
+//交还 [p, p + size) 中整页部分的物理内存
+inline void DecommitPages(void* p, size_t size) noexcept {
+	static const auto page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+	const auto begin = (reinterpret_cast<std::uintptr_t>(p) + page_size - 1) & ~(page_size - 1);
+	const auto end = (reinterpret_cast<std::uintptr_t>(p) + size) & ~(page_size - 1);
+	if (begin < end) {
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+	}
+}
+
+
+//HugePage：不小于 2 MiB 的 chunk 优先使用 MAP_HUGETLB，失败时对齐到 2 MiB 并 madvise(MADV_HUGEPAGE) 交给透明大页
+//Populate：分配时预先建立页表，避免首次访问时缺页
+template <bool HugePage = false, bool Populate = false>
+class MmapChunkSource {
+	static constexpr size_t huge_page_size = size_t{ 1 } << 21;
+
+public:
+	[[nodiscard]] void* allocate(size_t size, size_t align) {
+		const auto ret = try_allocate(size, align);
+		if (ret == nullptr) {
+			throw std::bad_alloc();
+		}
+		return ret;
+	}
+
+	//不抛出异常，可在持有 malloc 的锁时调用；size 过大时在取整之前失败
+	[[nodiscard]] void* try_allocate(size_t size, size_t align) noexcept {
+		if (size > std::numeric_limits<size_t>::max() / 2 || align > std::numeric_limits<size_t>::max() / 2) {
+			return nullptr;
+		}
+		size = MapSize(size);
+		const auto huge = HugePage && size % huge_page_size == 0;
+		if (huge) {
+			align = std::max(align, huge_page_size);
+#ifdef MAP_HUGETLB
+			if (const auto p = Map(size, MAP_HUGETLB | PopulateFlag()); p != nullptr) {
+				return p;
+			}
+#endif
+		}
+
+		//多映射 align - page_size 字节，再裁掉首尾以满足对齐
+		const auto page_size = PageSize();
+		const auto extra = align > page_size ? align - page_size : 0;
+		const auto raw = static_cast<std::byte*>(Map(size + extra, extra == 0 && !huge ? PopulateFlag() : 0));
+		if (raw == nullptr) {
+			return nullptr;
+		}
+
+		const auto p = raw + (-reinterpret_cast<std::uintptr_t>(raw) & (align - 1));
+		if (p != raw) {
+			munmap(raw, p - raw);
+		}
+		if (const auto tail = raw + size + extra - (p + size); tail != 0) {
+			munmap(p + size, tail);
+		}
+
+#ifdef MADV_HUGEPAGE
+		if (huge) {
+			madvise(p, size, MADV_HUGEPAGE);
+		}
+#endif
+		if (Populate && (extra != 0 || huge)) {
+			Prefault(p, size);
+		}
+		return p;
+	}
+
+	void deallocate(void* p, size_t size, size_t) noexcept {
+		munmap(p, MapSize(size));
+	}
+
+	void decommit(void* p, size_t size) noexcept {
+		DecommitPages(p, size);
+	}
+
+private:
+	[[nodiscard]] static size_t PageSize() noexcept {
+		static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return page_size;
+	}
+
+	[[nodiscard]] static size_t MapSize(size_t size) noexcept {
+		const auto granularity = HugePage && size >= huge_page_size ? huge_page_size : PageSize();
+		return (size + granularity - 1) & ~(granularity - 1);
+	}
+
+	[[nodiscard]] static constexpr int PopulateFlag() noexcept {
+#ifdef MAP_POPULATE
+		return Populate ? MAP_POPULATE : 0;
+#else
+		return 0;
+#endif
+	}
+
+	[[nodiscard]] static void* Map(size_t size, int flags) noexcept {
+		const auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+		return p == MAP_FAILED ? nullptr : p;
+	}
+
+	static void Prefault(std::byte* p, size_t size) noexcept {
+#ifdef MADV_POPULATE_WRITE
+		if (madvise(p, size, MADV_POPULATE_WRITE) == 0) {
+			return;
+		}
+#endif
+		for (auto it = p; it < p + size; it += PageSize()) {
+			*reinterpret_cast<volatile std::byte*>(it) = std::byte{};
+		}
+	}
+};
+
+#endif
+
+
+#ifdef __linux__
+
+//从预留给某个 NUMA 节点的一段虚拟地址中分配 chunk，整段地址已通过 mbind 绑定到该节点，
+//因此可以由地址直接算出内存所属的节点。释放的地址段按地址合并后留待复用
+//这些地址段按地址顺序串成单链表，节点存放在每段的首页中：首页保持可读写，其余部分为 PROT_NONE，因此回收时从不分配内存
+class NumaChunkSource {
+	struct FreeRange {
+		FreeRange* next;
+		size_t size; //包括首页
+
+		[[nodiscard]] std::byte* begin() noexcept {
+			return reinterpret_cast<std::byte*>(this);
+		}
+
+		[[nodiscard]] std::byte* end() noexcept {
+			return begin() + size;
+		}
+	};
+
+	std::byte* top{}; //尚未使用过的部分的起点，与它相接的地址段总是并入其中
+	std::byte* limit{};
+	FreeRange* released{};
+
+public:
+	NumaChunkSource() noexcept = default;
+
+	//[begin, begin + size) 须已以 PROT_NONE 预留
+	NumaChunkSource(void* begin, size_t size, int node) noexcept: top(static_cast<std::byte*>(begin)), limit(top + size) {
+		unsigned long mask[(1024 + std::numeric_limits<unsigned long>::digits - 1) / std::numeric_limits<unsigned long>::digits]{};
+		if (node >= 0 && node < 1024) {
+			mask[node / std::numeric_limits<unsigned long>::digits] |= 1ul << (node % std::numeric_limits<unsigned long>::digits);
+			//MPOL_PREFERRED：本节点内存耗尽时退回其他节点而不是失败
+			syscall(SYS_mbind, begin, size, MPOL_PREFERRED, mask, 1024 + 1, 0);
+		}
+	}
+
+	[[nodiscard]] void* allocate(size_t size, size_t align) {
+		size = MapSize(size);
+		align = std::max(align, PageSize());
+
+		auto p = Reuse(size, align);
+		if (p == nullptr) {
+			p = top + (-reinterpret_cast<std::uintptr_t>(top) & (align - 1));
+			if (p > limit || size > static_cast<size_t>(limit - p)) {
+				throw std::bad_alloc();
+			}
+			if (p != top) {
+				Release(top, static_cast<size_t>(p - top));
+			}
+			top = p + size;
+		}
+
+		if (mprotect(p, size, PROT_READ | PROT_WRITE) != 0) {
+			Release(p, size);
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+
+	void decommit(void* p, size_t size) noexcept {
+		DecommitPages(p, size);
+	}
+
+	void deallocate(void* p, size_t size, size_t) noexcept {
+		Release(static_cast<std::byte*>(p), MapSize(size));
+	}
+
+private:
+	[[nodiscard]] static size_t PageSize() noexcept {
+		static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return page_size;
+	}
+
+	[[nodiscard]] static size_t MapSize(size_t size) noexcept {
+		return (size + PageSize() - 1) & ~(PageSize() - 1);
+	}
+
+	//交还物理页并禁止访问
+	static void Protect(std::byte* p, size_t size) noexcept {
+		if (size != 0) {
+			madvise(p, size, MADV_DONTNEED);
+			mprotect(p, size, PROT_NONE);
+		}
+	}
+
+	//在 p 所在的首页写入节点；首页无法改为可读写时返回 nullptr，这段地址不再复用
+	[[nodiscard]] static FreeRange* NewRange(std::byte* p, size_t size, FreeRange* next) noexcept {
+		if (mprotect(p, PageSize(), PROT_READ | PROT_WRITE) != 0) {
+			return nullptr;
+		}
+		return new(p) FreeRange{ next, size };
+	}
+
+	//首次适配，切下对齐后的一段，前部仍使用原节点，尾部在其首页写入新节点
+	[[nodiscard]] std::byte* Reuse(size_t size, size_t align) noexcept {
+		for (auto link = &released; *link != nullptr; link = &(*link)->next) {
+			const auto range = *link;
+			const auto begin = range->begin();
+			const auto end = range->end();
+			const auto p = begin + (-reinterpret_cast<std::uintptr_t>(begin) & (align - 1));
+			if (p >= end || size > static_cast<size_t>(end - p)) {
+				continue;
+			}
+
+			auto rest = range->next;
+			if (p + size != end) {
+				if (const auto tail = NewRange(p + size, static_cast<size_t>(end - (p + size)), rest); tail != nullptr) {
+					rest = tail;
+				}
+			}
+			if (p != begin) {
+				range->size = static_cast<size_t>(p - begin);
+				range->next = rest;
+			} else {
+				*link = rest;
+			}
+			return p;
+		}
+		return nullptr;
+	}
+
+	//与前驱、后继相接时合并，与 top 相接时并入 top；不分配内存
+	void Release(std::byte* p, size_t size) noexcept {
+		Protect(p, size);
+
+		FreeRange** prev = nullptr;
+		auto link = &released;
+		while (*link != nullptr && (*link)->begin() < p) {
+			prev = link;
+			link = &(*link)->next;
+		}
+
+		//后继的首页成为中间部分
+		auto next = *link;
+		if (next != nullptr && p + size == next->begin()) {
+			const auto [after, length] = *next;
+			Protect(next->begin(), PageSize());
+			size += length;
+			next = after;
+		}
+
+		if (prev != nullptr && (*prev)->end() == p) {
+			const auto range = *prev;
+			if (p + size == top) {
+				*prev = next;
+				top = range->begin();
+				Protect(top, PageSize());
+			} else {
+				range->size += size;
+				range->next = next;
+			}
+			return;
+		}
+
+		if (p + size == top) {
+			top = p;
+			*link = next;
+			return;
+		}
+		const auto range = NewRange(p, size, next);
+		*link = range != nullptr ? range : next;
+	}
+};
+
+#endif
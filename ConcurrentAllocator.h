@@ -0,0 +1,120 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+
+template <typename T>
+class ConcurrentAllocator {
+	static_assert(sizeof(void*) == 8, "Tagged pointers require a 64-bit address space.");
+
+	static constexpr size_t blocks_per_chunk = size_t{ 1 } << 10;
+
+	//用户态地址只使用低 48 位，高 16 位存放版本号以避免 ABA 问题
+	static constexpr unsigned tag_shift = 48;
+	static constexpr std::uintptr_t pointer_mask = (std::uintptr_t{ 1 } << tag_shift) - 1;
+
+	struct FreeBlock {
+		alignas(T) std::byte buffer[sizeof(T)];
+		std::atomic<void*> link; //已分配时为 mask，未分配时为 next
+	};
+
+	struct Chunk {
+		FreeBlock blocks[blocks_per_chunk];
+		Chunk* next{};
+
+		Chunk() noexcept {
+			auto it = blocks;
+			it->link.store(it->buffer, std::memory_order_relaxed); //第一个 block 用于分配
+			for (++it; it != blocks + blocks_per_chunk - 1; ++it) {
+				it->link.store(it + 1, std::memory_order_relaxed);
+			}
+			it->link.store(nullptr, std::memory_order_relaxed);
+		}
+	};
+
+	std::atomic<Chunk*> chunk_head{};
+	std::atomic<std::uintptr_t> free_block_head{};
+
+public:
+	ConcurrentAllocator() noexcept = default;
+	ConcurrentAllocator(const ConcurrentAllocator&) = delete;
+	ConcurrentAllocator& operator=(const ConcurrentAllocator&) = delete;
+
+	~ConcurrentAllocator() noexcept {
+		auto chunk = chunk_head.load(std::memory_order_acquire);
+		while (chunk) {
+			delete std::exchange(chunk, chunk->next);
+		}
+	}
+
+	[[nodiscard]] T* allocate() {
+		if (const auto block = Pop(); block != nullptr) {
+			block->link.store(block->buffer, std::memory_order_relaxed);
+			return reinterpret_cast<T*>(block);
+		}
+
+		const auto chunk = new Chunk;
+		chunk->next = chunk_head.load(std::memory_order_relaxed);
+		while (!chunk_head.compare_exchange_weak(chunk->next, chunk, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+
+		Push(chunk->blocks + 1, chunk->blocks + blocks_per_chunk - 1);
+		return reinterpret_cast<T*>(chunk->blocks);
+	}
+
+	void deallocate(T* p) {
+		const auto block = reinterpret_cast<FreeBlock*>(p);
+		if (block->link.load(std::memory_order_relaxed) != p) {
+			throw std::runtime_error("The pointer is not allocated from here.");
+		}
+
+		Push(block, block);
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&& ... args) {
+		std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) noexcept {
+		p->~U();
+	}
+
+private:
+	[[nodiscard]] static FreeBlock* Pointer(std::uintptr_t head) noexcept {
+		return reinterpret_cast<FreeBlock*>(head & pointer_mask);
+	}
+
+	[[nodiscard]] static std::uintptr_t Tagged(FreeBlock* block, std::uintptr_t prev_head) noexcept {
+		return reinterpret_cast<std::uintptr_t>(block) | ((prev_head & ~pointer_mask) + (std::uintptr_t{ 1 } << tag_shift));
+	}
+
+	//弹出栈顶；被弹出的 block 即使已被其他线程重新分配，其 link 仍可安全读取，版本号保证 CAS 失败
+	[[nodiscard]] FreeBlock* Pop() noexcept {
+		auto head = free_block_head.load(std::memory_order_acquire);
+		while (const auto block = Pointer(head)) {
+			const auto next = static_cast<FreeBlock*>(block->link.load(std::memory_order_relaxed));
+			if (free_block_head.compare_exchange_weak(head, Tagged(next, head), std::memory_order_acquire, std::memory_order_acquire)) {
+				return block;
+			}
+		}
+		return nullptr;
+	}
+
+	//将已链接好的 [first, last] 整段压入栈顶
+	void Push(FreeBlock* first, FreeBlock* last) noexcept {
+		auto head = free_block_head.load(std::memory_order_relaxed);
+		do {
+			last->link.store(Pointer(head), std::memory_order_relaxed);
+		} while (!free_block_head.compare_exchange_weak(head, Tagged(first, head), std::memory_order_release, std::memory_order_relaxed));
+	}
+};
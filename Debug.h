@@ -0,0 +1,127 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+
+//为 1 时 Allocator 与 MemoryPool 在每块之后加 redzone，回收时校验并以 freed_byte 填满，默认关闭；关闭时下面的函数均不被调用，布局与发布构建相同
+#ifndef MEMORY_MANAGER_DEBUG
+#define MEMORY_MANAGER_DEBUG 0
+#endif
+
+//调试模式下自动检测 AddressSanitizer 与 Valgrind，把 redzone 与空闲内存标记为不可访问
+#if MEMORY_MANAGER_DEBUG
+#if defined(__SANITIZE_ADDRESS__)
+#define MEMORY_MANAGER_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEMORY_MANAGER_ASAN 1
+#endif
+#endif
+#if defined(MEMORY_MANAGER_ASAN)
+#include <sanitizer/asan_interface.h>
+#endif
+#if __has_include(<valgrind/memcheck.h>)
+#define MEMORY_MANAGER_VALGRIND 1
+#include <valgrind/memcheck.h>
+#endif
+#endif
+
+
+namespace memory_debug {
+	inline constexpr bool enabled = MEMORY_MANAGER_DEBUG;
+
+	inline constexpr std::byte freed_byte{ 0xdd }; //回收后填满空闲内存
+	inline constexpr std::byte guard_byte{ 0xfd }; //填满 redzone
+
+	//Allocator 在 T 之后的 guard 字节数
+	inline constexpr size_t guard_size = enabled ? 16 : 0;
+
+	//MemoryPool 每次分配额外申请的字节数，最后一个字记录请求的大小
+	inline constexpr size_t redzone_size = enabled ? 32 : 0;
+
+	//不可访问：之后的读写由 AddressSanitizer 或 Valgrind 报告
+	inline void poison([[maybe_unused]] void* p, [[maybe_unused]] size_t size) noexcept {
+#if defined(MEMORY_MANAGER_ASAN)
+		ASAN_POISON_MEMORY_REGION(p, size);
+#endif
+#if defined(MEMORY_MANAGER_VALGRIND)
+		VALGRIND_MAKE_MEM_NOACCESS(p, size);
+#endif
+	}
+
+	//可访问但内容未初始化，交给调用者之前使用
+	inline void unpoison([[maybe_unused]] void* p, [[maybe_unused]] size_t size) noexcept {
+#if defined(MEMORY_MANAGER_ASAN)
+		ASAN_UNPOISON_MEMORY_REGION(p, size);
+#endif
+#if defined(MEMORY_MANAGER_VALGRIND)
+		VALGRIND_MAKE_MEM_UNDEFINED(p, size);
+#endif
+	}
+
+	//可访问且内容有效，读取之前写入的填充字节时使用
+	inline void unpoison_defined([[maybe_unused]] void* p, [[maybe_unused]] size_t size) noexcept {
+#if defined(MEMORY_MANAGER_ASAN)
+		ASAN_UNPOISON_MEMORY_REGION(p, size);
+#endif
+#if defined(MEMORY_MANAGER_VALGRIND)
+		VALGRIND_MAKE_MEM_DEFINED(p, size);
+#endif
+	}
+
+	inline void fill(void* p, size_t size, std::byte value) noexcept {
+		std::memset(p, static_cast<int>(value), size);
+	}
+
+	//[p, p + size) 不全为 value 时抛出 std::runtime_error
+	inline void check(const void* p, size_t size, std::byte value, const char* message) {
+		const auto begin = static_cast<const std::byte*>(p);
+		if (std::any_of(begin, begin + size, [value](std::byte b) { return b != value; })) {
+			throw std::runtime_error(message);
+		}
+	}
+
+	//p 之后 usable 字节可用，请求 size 字节：[size, usable) 为 redzone，最后一个字记录 size，其余填满 guard_byte 并标记为不可访问
+	inline void guard(void* p, size_t size, size_t usable) noexcept {
+		const auto begin = static_cast<std::byte*>(p);
+		unpoison(begin, usable);
+		fill(begin + size, usable - size - sizeof(size_t), guard_byte);
+		std::memcpy(begin + usable - sizeof(size_t), &size, sizeof(size_t));
+		poison(begin + size, usable - size);
+	}
+
+	//读出 guard 记录的大小，不改变可访问性
+	[[nodiscard]] inline size_t requested_size(void* p, size_t usable) noexcept {
+		const auto last = static_cast<std::byte*>(p) + usable - sizeof(size_t);
+		unpoison_defined(last, sizeof(size_t));
+		size_t size;
+		std::memcpy(&size, last, sizeof(size_t));
+		poison(last, sizeof(size_t));
+		return size;
+	}
+
+	//校验 redzone 并使整块可以访问，返回请求的大小；redzone 被改写时抛出 std::runtime_error
+	inline size_t unguard(void* p, size_t usable) {
+		const auto begin = static_cast<std::byte*>(p);
+		const auto size = requested_size(p, usable);
+		if (size > usable - redzone_size) {
+			throw std::runtime_error("The block is freed twice or its redzone is overwritten.");
+		}
+		unpoison_defined(begin + size, usable - size);
+		check(begin + size, usable - size - sizeof(size_t), guard_byte, "The redzone after the allocation is overwritten.");
+		return size;
+	}
+
+	//回收之前调用：校验 redzone 后把整块以 freed_byte 填满
+	inline void release(void* p, size_t usable) {
+		static_cast<void>(unguard(p, usable));
+		fill(p, usable, freed_byte);
+	}
+}
@@ -0,0 +1,221 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "Allocator.h"
+#include "ChunkSource.h"
+
+
+//注重局部性的定长分配：存活的对象尽量挤在少数几个 chunk 的低地址处，遍历时按地址顺序访问
+//chunk 按 ChunkSize 对齐，由地址直接算出所属的 chunk；每个 chunk 以位图记录存活的 block，总是分配其中地址最低的空闲 block，空闲 block 本身不被写入
+//未满的 chunk 按占用率分为若干档，分配时优先使用最满的一档，接近空的 chunk 因此逐渐腾空并可被 trim 归还
+template <typename T, size_t ChunkSize = size_t{ 1 } << 16, typename ChunkSource = NewChunkSource>
+class DenseAllocator {
+	static_assert(std::has_single_bit(ChunkSize) && alignof(T) <= ChunkSize);
+
+	static constexpr size_t cache_line = 64;
+	static constexpr size_t block_size = sizeof(T);
+	static constexpr size_t word_bits = 64;
+	static constexpr size_t max_words = (ChunkSize / block_size + word_bits - 1) / word_bits;
+	static constexpr size_t level_count = 7; //0 为空的 chunk，1 到 6 按占用率递增，满的 chunk 不在任何一档中
+
+	//blocks 从缓存行对齐的位置开始，大小为 2 的幂且不超过缓存行的 T 不会跨越缓存行
+	struct alignas(std::max(cache_line, alignof(T))) Chunk {
+		Chunk* next; //所有 chunk 按地址排序的单链表
+		Chunk* level_prev;
+		Chunk* level_next;
+		size_t level;
+		size_t live_count;
+		size_t first_free_word; //此前的字都已满
+		uint64_t live[max_words];
+
+		[[nodiscard]] std::byte* blocks() noexcept {
+			return reinterpret_cast<std::byte*>(this) + header_size;
+		}
+	};
+
+	static constexpr size_t header_size = sizeof(Chunk);
+	static constexpr size_t block_count = (ChunkSize - header_size) / block_size;
+
+	static_assert(block_count >= 2, "ChunkSize is too small for T.");
+	static_assert((block_count + word_bits - 1) / word_bits <= max_words);
+
+	Chunk* chunk_head{};
+	Chunk* levels[level_count]{};
+	size_t level_mask{}; //非空的档
+	size_t chunk_count{};
+	size_t live_count{};
+	[[no_unique_address]] ChunkSource chunk_source{};
+
+public:
+	constexpr DenseAllocator() noexcept = default;
+
+	constexpr explicit DenseAllocator(const ChunkSource& chunk_source) noexcept: chunk_source(chunk_source) {}
+
+	DenseAllocator(const DenseAllocator&) = delete;
+	DenseAllocator& operator=(const DenseAllocator&) = delete;
+
+	~DenseAllocator() noexcept {
+		while (chunk_head != nullptr) {
+			chunk_source.deallocate(std::exchange(chunk_head, chunk_head->next), ChunkSize, ChunkSize);
+		}
+	}
+
+	//从最满的未满 chunk 中取地址最低的空闲 block，都满时申请新 chunk
+	[[nodiscard]] T* allocate() {
+		const auto chunk = level_mask != 0 ? levels[std::bit_width(level_mask) - 1] : NewChunk();
+		auto word = chunk->first_free_word;
+		while (chunk->live[word] == ~uint64_t{}) {
+			++word;
+		}
+		const auto bit = static_cast<size_t>(std::countr_one(chunk->live[word]));
+		chunk->live[word] |= uint64_t{ 1 } << bit;
+		chunk->first_free_word = word;
+		++chunk->live_count;
+		++live_count;
+		Relevel(chunk);
+		return reinterpret_cast<T*>(chunk->blocks() + (word * word_bits + bit) * block_size);
+	}
+
+	void deallocate(T* p) {
+		const auto chunk = Owner(p);
+		const auto index = static_cast<size_t>(reinterpret_cast<std::byte*>(p) - chunk->blocks()) / block_size;
+		const auto word = index / word_bits;
+		const auto mask = uint64_t{ 1 } << (index % word_bits);
+#if ALLOCATOR_CHECK_OWNERSHIP
+		if ((chunk->live[word] & mask) == 0) {
+			throw std::runtime_error("The pointer is not allocated from here.");
+		}
+#endif
+		chunk->live[word] &= ~mask;
+		chunk->first_free_word = std::min(chunk->first_free_word, word);
+		--chunk->live_count;
+		--live_count;
+		Relevel(chunk);
+	}
+
+	//按地址顺序对每个存活的 block 调用 f(T*)；f 中不能分配或回收
+	template <typename F>
+	void for_each(F&& f) {
+		for (auto chunk = chunk_head; chunk != nullptr; chunk = chunk->next) {
+			for (size_t word = 0, remaining = chunk->live_count; remaining != 0; ++word) {
+				for (auto bits = chunk->live[word]; bits != 0; bits &= bits - 1, --remaining) {
+					f(reinterpret_cast<T*>(chunk->blocks() + (word * word_bits + static_cast<size_t>(std::countr_zero(bits))) * block_size));
+				}
+			}
+		}
+	}
+
+	//将空的 chunk 归还 ChunkSource，返回归还的字节数
+	size_t trim() noexcept {
+		size_t released = 0;
+		for (auto link = &chunk_head; *link != nullptr;) {
+			const auto chunk = *link;
+			if (chunk->live_count == 0) {
+				*link = chunk->next;
+				Unlink(chunk);
+				--chunk_count;
+				released += ChunkSize;
+				chunk_source.deallocate(chunk, ChunkSize, ChunkSize);
+			} else {
+				link = &chunk->next;
+			}
+		}
+		return released;
+	}
+
+	[[nodiscard]] size_t size() const noexcept {
+		return live_count;
+	}
+
+	[[nodiscard]] size_t capacity() const noexcept {
+		return chunk_count * block_count;
+	}
+
+	[[nodiscard]] static constexpr size_t blocks_per_chunk() noexcept {
+		return block_count;
+	}
+
+private:
+	[[nodiscard]] static Chunk* Owner(const void* p) noexcept {
+		return reinterpret_cast<Chunk*>(reinterpret_cast<std::uintptr_t>(p) & ~(ChunkSize - 1));
+	}
+
+	[[nodiscard]] static constexpr size_t Level(size_t live) noexcept {
+		if (live == block_count) {
+			return level_count;
+		}
+		return live == 0 ? 0 : 1 + live * (level_count - 1) / block_count;
+	}
+
+	//新 chunk 按地址插入，for_each 因此按地址顺序遍历所有 chunk
+	[[nodiscard]] Chunk* NewChunk() {
+		const auto chunk = new(chunk_source.allocate(ChunkSize, ChunkSize)) Chunk{};
+		auto link = &chunk_head;
+		while (*link != nullptr && *link < chunk) {
+			link = &(*link)->next;
+		}
+		chunk->next = *link;
+		*link = chunk;
+		++chunk_count;
+		Link(chunk, 0);
+		return chunk;
+	}
+
+	void Link(Chunk* chunk, size_t level) noexcept {
+		chunk->level = level;
+		if (level == level_count) {
+			return;
+		}
+		chunk->level_prev = nullptr;
+		chunk->level_next = levels[level];
+		if (chunk->level_next != nullptr) {
+			chunk->level_next->level_prev = chunk;
+		}
+		levels[level] = chunk;
+		level_mask |= size_t{ 1 } << level;
+	}
+
+	void Unlink(Chunk* chunk) noexcept {
+		if (chunk->level == level_count) {
+			return;
+		}
+		if (chunk->level_next != nullptr) {
+			chunk->level_next->level_prev = chunk->level_prev;
+		}
+		if (chunk->level_prev != nullptr) {
+			chunk->level_prev->level_next = chunk->level_next;
+		} else if ((levels[chunk->level] = chunk->level_next) == nullptr) {
+			level_mask &= ~(size_t{ 1 } << chunk->level);
+		}
+	}
+
+	//占用率跨过一档时移到对应的链表头部
+	void Relevel(Chunk* chunk) noexcept {
+		if (const auto level = Level(chunk->live_count); level != chunk->level) {
+			Unlink(chunk);
+			Link(chunk, level);
+		}
+	}
+
+public:
+	template <typename U, typename... Args>
+	void construct(U* p, Args&& ... args) {
+		std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) noexcept {
+		p->~U();
+	}
+};
@@ -0,0 +1,423 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MemoryPool.h"
+#include "Tlsf.h"
+
+
+//以相对自身地址的偏移表示的指针，存放在 MappedPool 中的对象之间互相引用时使用，映射到不同地址的进程看到的指向相同
+//与 Boost.Interprocess 相同以偏移 1 表示空指针，偏移 0 即指向自身；因此不能指向紧随自身首字节之后的那个字节
+template <typename T>
+class OffsetPtr {
+	static constexpr std::intptr_t null_offset = 1;
+
+	std::intptr_t offset{ null_offset };
+
+public:
+	constexpr OffsetPtr() noexcept = default;
+
+	constexpr OffsetPtr(std::nullptr_t) noexcept {}
+
+	OffsetPtr(T* p) noexcept {
+		*this = p;
+	}
+
+	OffsetPtr(const OffsetPtr& other) noexcept: OffsetPtr(other.get()) {}
+
+	OffsetPtr& operator=(const OffsetPtr& other) noexcept {
+		return *this = other.get();
+	}
+
+	OffsetPtr& operator=(T* p) noexcept {
+		offset = p == nullptr ? null_offset : reinterpret_cast<std::intptr_t>(p) - reinterpret_cast<std::intptr_t>(this);
+		return *this;
+	}
+
+	[[nodiscard]] T* get() const noexcept {
+		return offset == null_offset ? nullptr : reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + offset);
+	}
+
+	[[nodiscard]] std::add_lvalue_reference_t<T> operator*() const noexcept requires (!std::is_void_v<T>) {
+		return *get();
+	}
+
+	[[nodiscard]] T* operator->() const noexcept {
+		return get();
+	}
+
+	[[nodiscard]] explicit operator bool() const noexcept {
+		return offset != null_offset;
+	}
+
+	[[nodiscard]] friend bool operator==(const OffsetPtr& lhs, const OffsetPtr& rhs) noexcept {
+		return lhs.get() == rhs.get();
+	}
+};
+
+
+enum class MappedBacking {
+	file, //普通文件，进程重启后可重新打开
+	shared_memory //shm_open 创建的共享内存对象，重启机器后消失
+};
+
+
+/*
+ * 整个内存池放在一段以 MAP_SHARED 映射的文件或共享内存中，多个进程可以同时打开同一个内存池，进程重启后重新打开即可继续使用已有的数据。
+ * 映射的开头是池头，记录 TLSF 的分类与位图以及进程间共享的互斥锁，其后是与 RealTimePool 相同的带块头的块；块头与空闲链表只存放相对映射起点的偏移，
+ * 因此每个进程可以把它映射到任意地址。所有操作都在进程间的 robust 互斥锁中进行，持锁的进程崩溃时下一个加锁的进程接管，但该次操作可能只完成了一半。
+ */
+class MappedPool {
+	static constexpr uint64_t magic = 0x4c4f4f5044455050; //"PPEDPOOL"
+	static constexpr uint64_t version = 1;
+	static constexpr size_t alignment = alignof(std::max_align_t);
+	static constexpr size_t page_size = PageMap<>::page_size; //映射按页对齐，不超过一页的对齐在各进程中都成立
+	//块头中的引用是相对映射起点的偏移，0 表示没有；映射起点按页对齐，因此偏移的对齐即地址的对齐
+	template <typename Node>
+	struct OffsetAddressing {
+		using Ref = uint64_t;
+
+		std::byte* base;
+
+		[[nodiscard]] Node* get(Ref ref) const noexcept {
+			return reinterpret_cast<Node*>(base + ref);
+		}
+
+		[[nodiscard]] Ref ref(const Node* node) const noexcept {
+			return static_cast<uint64_t>(reinterpret_cast<const std::byte*>(node) - base);
+		}
+	};
+
+	//与 RealTimePool 相同的块布局，只是块头中存放偏移
+	using Heap = TlsfHeap<OffsetAddressing>;
+
+	static constexpr size_t header_size = Heap::header_size;
+	static constexpr size_t min_block_size = Heap::min_block_size;
+
+	//映射开头的池头，magic 最后写入，格式化到一半时崩溃的文件下次打开时重新格式化
+	struct PoolHeader {
+		uint64_t magic;
+		uint64_t version;
+		uint64_t capacity; //整个映射的字节数
+		uint64_t root;
+		Heap::State heap; //分类索引与空闲统计，布局与逐个列出这些 uint64_t 时相同
+		pthread_mutex_t mutex;
+	};
+
+	static constexpr size_t data_offset = (sizeof(PoolHeader) + alignment - 1) & ~(alignment - 1);
+	static constexpr size_t min_capacity = data_offset + min_block_size + header_size;
+
+	//robust 互斥锁：持锁的进程退出时由下一个加锁者标记为一致后继续使用；其余错误（ENOTRECOVERABLE、池头损坏时的 EINVAL 等）抛出 std::runtime_error，不在未持锁时修改共享的状态
+	class Lock {
+		pthread_mutex_t* mutex;
+
+	public:
+		explicit Lock(pthread_mutex_t* mutex): mutex(mutex) {
+			auto error = pthread_mutex_lock(mutex);
+			if (error == EOWNERDEAD) {
+				error = pthread_mutex_consistent(mutex);
+				if (error != 0) {
+					pthread_mutex_unlock(mutex);
+				}
+			}
+			if (error != 0) {
+				throw std::runtime_error("Failed to lock the MappedPool.");
+			}
+		}
+
+		Lock(const Lock&) = delete;
+		Lock& operator=(const Lock&) = delete;
+
+		~Lock() noexcept {
+			pthread_mutex_unlock(mutex);
+		}
+	};
+
+	std::byte* base{};
+	size_t mapped{};
+	int fd{ -1 };
+	[[no_unique_address]] PoolCounters counters{}; //只统计本进程的操作
+
+public:
+	//打开或创建 name；新建时大小为 size 向上取整到页，已有的内存池忽略 size 并沿用原来的容量。失败时抛出 std::runtime_error
+	MappedPool(const char* name, size_t size, MappedBacking backing = MappedBacking::file) {
+		fd = backing == MappedBacking::file ? ::open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600) : shm_open(name, O_RDWR | O_CREAT, 0600);
+		if (fd < 0) {
+			throw std::runtime_error("Failed to open the backing file.");
+		}
+		try {
+			Attach(size);
+		} catch (...) {
+			Detach();
+			throw;
+		}
+	}
+
+	MappedPool(const MappedPool&) = delete;
+	MappedPool& operator=(const MappedPool&) = delete;
+
+	//只解除映射，数据留在文件或共享内存中
+	~MappedPool() noexcept {
+		Detach();
+	}
+
+	//删除文件或共享内存对象，已打开的进程仍可继续使用直到关闭
+	static bool remove(const char* name, MappedBacking backing = MappedBacking::file) noexcept {
+		return (backing == MappedBacking::file ? ::unlink(name) : shm_unlink(name)) == 0;
+	}
+
+private:
+	[[nodiscard]] PoolHeader& Header() const noexcept {
+		return *reinterpret_cast<PoolHeader*>(base);
+	}
+
+	[[nodiscard]] Heap Blocks() const noexcept {
+		return { Header().heap, { base } };
+	}
+
+	[[nodiscard]] uint64_t Offset(const void* p) const noexcept {
+		return static_cast<uint64_t>(static_cast<const std::byte*>(p) - base);
+	}
+
+	/*
+	 * 每个打开的进程对文件持有共享的 flock。能取得独占 flock 的进程是唯一打开者，上次留下的互斥锁可能属于已经不存在的进程或机器，此时重新初始化；
+	 * 新建或未格式化完成的文件也只在独占时格式化，之后降为共享 flock。其他进程在格式化期间阻塞在共享 flock 上。
+	 */
+	void Attach(size_t size) {
+		const auto exclusive = flock(fd, LOCK_EX | LOCK_NB) == 0;
+		if (!exclusive && flock(fd, LOCK_SH) != 0) {
+			throw std::runtime_error("Failed to lock the backing file.");
+		}
+
+		struct stat st{};
+		if (fstat(fd, &st) != 0) {
+			throw std::runtime_error("Failed to stat the backing file.");
+		}
+		auto bytes = static_cast<size_t>(st.st_size);
+		if (exclusive && bytes == 0) {
+			bytes = (std::max(size, min_capacity) + page_size - 1) & ~(page_size - 1);
+			if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+				throw std::runtime_error("Failed to resize the backing file.");
+			}
+		}
+		if (bytes < min_capacity) {
+			throw std::runtime_error("The backing file is too small.");
+		}
+
+		const auto p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			throw std::runtime_error("Failed to map the backing file.");
+		}
+		base = static_cast<std::byte*>(p);
+		mapped = bytes;
+
+		auto& header = Header();
+		if (std::atomic_ref{ header.magic }.load(std::memory_order_acquire) != magic) {
+			if (!exclusive || header.magic != 0) {
+				throw std::runtime_error("The backing file is not a MappedPool.");
+			}
+			Format();
+		} else if (header.version != version || header.capacity != mapped) {
+			throw std::runtime_error("The backing file is not compatible with this MappedPool.");
+		} else if (exclusive) {
+			InitMutex();
+		}
+
+		if (exclusive && flock(fd, LOCK_SH) != 0) {
+			throw std::runtime_error("Failed to lock the backing file.");
+		}
+	}
+
+	void Detach() noexcept {
+		if (base != nullptr) {
+			munmap(base, mapped);
+			base = nullptr;
+		}
+		if (fd >= 0) {
+			::close(fd); //同时释放 flock
+			fd = -1;
+		}
+	}
+
+	void InitMutex() {
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+		const auto error = pthread_mutex_init(&Header().mutex, &attr);
+		pthread_mutexattr_destroy(&attr);
+		if (error != 0) {
+			throw std::runtime_error("Failed to initialize the process-shared mutex.");
+		}
+	}
+
+	//池头之后是一个空闲块，最后是一个已分配的空块头，作为合并的边界
+	void Format() {
+		auto& header = Header();
+		std::memset(base, 0, sizeof(PoolHeader));
+		InitMutex();
+		header.version = version;
+		header.capacity = mapped;
+
+		Blocks().format(base + data_offset, mapped - data_offset);
+		std::atomic_ref{ header.magic }.store(magic, std::memory_order_release);
+	}
+
+public:
+	//空间不足或 align 超过一页时返回 nullptr；align 须为 2 的幂。以下各操作在互斥锁无法使用时都抛出 std::runtime_error
+	[[nodiscard]] void* try_allocate(size_t size, size_t align = alignment) {
+		if (size == 0 || size > mapped || align > page_size) {
+			return nullptr;
+		}
+
+		const Lock lock(&Header().mutex);
+		const auto ret = Blocks().allocate(size, align);
+		if (ret == nullptr) {
+			return nullptr;
+		}
+		counters.add(PoolEvent::allocate);
+		counters.record(std::bit_width(size - 1));
+		return ret;
+	}
+
+	//空间不足时抛出 std::bad_alloc
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] void* allocate(size_t size, size_t align = alignment) {
+		if (size == 0) {
+			return nullptr;
+		}
+		if (const auto ret = try_allocate(size, align); ret != nullptr) {
+			return ret;
+		}
+		throw std::bad_alloc();
+	}
+
+	[[nodiscard, gnu::alloc_size(2)]] void* allocate(size_t size, std::align_val_t align) {
+		return allocate(size, static_cast<size_t>(align));
+	}
+
+	//可以回收其他进程分配的块
+	void deallocate(void* p) {
+		if (p == nullptr) {
+			return;
+		}
+
+		counters.add(PoolEvent::deallocate);
+		const Lock lock(&Header().mutex);
+		counters.add(PoolEvent::merge, Blocks().deallocate(p));
+	}
+
+	void deallocate(void* p, [[maybe_unused]] size_t size, [[maybe_unused]] size_t align = alignment) {
+		if (p == nullptr || size == 0) {
+			return;
+		}
+#if MEMORY_POOL_CHECK_SIZE
+		if (!Heap::matches(p, size, align)) {
+			throw std::runtime_error("The size does not match the allocation.");
+		}
+#endif
+		deallocate(p);
+	}
+
+	void deallocate(void* p, size_t size, std::align_val_t align) {
+		deallocate(p, size, static_cast<size_t>(align));
+	}
+
+	[[nodiscard]] size_t usable_size(void* p) const noexcept {
+		return Heap::usable_size(p);
+	}
+
+	template <typename T>
+	[[nodiscard]] T* allocate() {
+		return static_cast<T*>(allocate(sizeof(T), alignof(T)));
+	}
+
+	template <typename T>
+	void deallocate(T* p) {
+		deallocate(p, sizeof(T), alignof(T));
+	}
+
+	//p 相对映射起点的偏移，可经管道或套接字传给其他进程后由 at 换回地址
+	[[nodiscard]] uint64_t offset_of(const void* p) const noexcept {
+		return p == nullptr ? 0 : Offset(p);
+	}
+
+	[[nodiscard]] void* at(uint64_t offset) const noexcept {
+		return offset == 0 ? nullptr : base + offset;
+	}
+
+	template <typename T>
+	[[nodiscard]] T* at(uint64_t offset) const noexcept {
+		return static_cast<T*>(at(offset));
+	}
+
+	//根对象保存在池头中，重新打开后由 root 取回，作为持久数据的入口
+	void set_root(const void* p) noexcept {
+		std::atomic_ref{ Header().root }.store(offset_of(p), std::memory_order_release);
+	}
+
+	[[nodiscard]] void* root() const noexcept {
+		return at(std::atomic_ref{ Header().root }.load(std::memory_order_acquire));
+	}
+
+	template <typename T>
+	[[nodiscard]] T* root() const noexcept {
+		return static_cast<T*>(root());
+	}
+
+	//把修改写回文件，返回是否成功；共享内存无需调用
+	bool sync() const noexcept {
+		return msync(base, mapped, MS_SYNC) == 0;
+	}
+
+	//整个映射作为一个 chunk；largest_free_block 只扫描最大的非空分类
+	[[nodiscard]] MemoryPoolStats stats() const {
+		const Lock lock(&Header().mutex);
+		const auto& heap = Header().heap;
+		return {
+			1,
+			mapped,
+			0,
+			0,
+			0,
+			heap.free_count,
+			heap.free_bytes,
+			0,
+			Heap::largest(heap, { base }),
+			mapped - heap.free_bytes,
+			counters.snapshot()
+		};
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&& ... args) {
+		std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) noexcept {
+		p->~U();
+	}
+};
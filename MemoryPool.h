@@ -6,176 +6,1385 @@
 
 #include <utility>
 #include <memory>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <array>
+#include <stdexcept>
+#include <type_traits>
 
+#include "Allocator.h"
+#include "ChunkSource.h"
+#include "Debug.h"
+#include "PageMap.h"
+#include "Profiler.h"
+#include "RemoteFreeList.h"
+#include "Stats.h"
+#include "Tlsf.h"
 
-class MemoryPool {
-	static constexpr size_t chunk_size = size_t{ 1 } << 12;
 
-	struct Chunk {
+//为 1 时带 size 的 deallocate 校验 size 和 align 与分配时相同，不同则抛出 std::runtime_error
+#ifndef MEMORY_POOL_CHECK_SIZE
+#ifdef NDEBUG
+#define MEMORY_POOL_CHECK_SIZE 0
+#else
+#define MEMORY_POOL_CHECK_SIZE 1
+#endif
+#endif
+
+
+//MEMORY_MANAGER_STATS 为 1 时记录的事件
+enum class PoolEvent : size_t {
+	allocate,
+	deallocate,
+	large_allocate, //直接向 ChunkSource 申请
+	large_deallocate,
+	large_reuse, //大块内存从最近回收的缓存中复用
+	new_chunk,
+	merge, //回收时与相邻空闲块合并的次数
+	remote_deallocate, //经 deallocate_remote 回收、由下次分配取回的块
+	resize, //try_expand 或 reallocate 原地调整成功
+	trim,
+	count
+};
+
+//请求大小按 bit_width(size - 1) 分类，第 i 类为 (2^(i-1), 2^i] 字节
+inline constexpr size_t pool_histogram_size = std::numeric_limits<size_t>::digits + 1;
+
+using PoolCounters = Counters<PoolEvent, pool_histogram_size>;
+using PoolCounterSnapshot = CounterSnapshot<PoolEvent, pool_histogram_size>;
+
+struct MemoryPoolStats {
+	size_t chunk_count;
+	size_t chunk_bytes; //包括 chunk 头
+	size_t large_count; //直接向 ChunkSource 申请的大块
+	size_t large_bytes;
+	size_t large_cached_bytes; //最近回收、尚未还给 ChunkSource 的大块
+	size_t free_block_count;
+	size_t free_bytes; //FreeBlockList 中空闲的字节数
+	size_t cached_bytes; //size class 空闲链表中的字节数
+	size_t largest_free_block;
+	size_t live_bytes; //已分配出去的字节数，包括块头与 slab 末尾不足一块的部分
+	PoolCounterSnapshot counters;
+
+	[[nodiscard]] constexpr size_t reserved_bytes() const noexcept {
+		return chunk_bytes + large_bytes + large_cached_bytes;
+	}
+
+	//空闲内存中无法被最大的空闲块满足的比例，0 表示没有碎片
+	[[nodiscard]] constexpr double fragmentation() const noexcept {
+		return free_bytes == 0 ? 0.0 : 1.0 - static_cast<double>(largest_free_block) / static_cast<double>(free_bytes);
+	}
+};
+
+
+//每个 chunk 的大小从 MinChunkSize 开始按 2 倍增长，直至 MaxChunkSize；chunk 与大块内存均由 ChunkSource 提供
+template <size_t MinChunkSize = size_t{ 1 } << 12, size_t MaxChunkSize = size_t{ 1 } << 20, typename ChunkSource = NewChunkSource>
+class BasicMemoryPool {
+	static_assert(std::has_single_bit(MinChunkSize) && std::has_single_bit(MaxChunkSize) && MinChunkSize <= MaxChunkSize);
+
+	static constexpr size_t alignment = alignof(std::max_align_t); //所有块的大小和地址都按 alignment 对齐
+	static constexpr size_t large_size = MaxChunkSize / 2; //对齐后不小于此大小的请求直接向系统申请
+	static constexpr size_t decommit_size = size_t{ 1 } << 16; //trim 时不小于此大小的空闲块交还物理页
+	static constexpr size_t small_size = 256; //对齐后不超过此大小且无额外对齐要求的请求由 size class 的空闲链表分配
+	static constexpr size_t page_size = PageMap<>::page_size; //slab 与大块内存都按页对齐，chunk 也按页对齐以免浪费
+
+	//size class 的间隔与对齐粒度相同，每个 slab 占一页，由 page map 记录所属的 size class
+	struct SizeClassInfo {
+		size_t size;
+		size_t batch_count; //每个 slab 的块数
+	};
+
+	static constexpr size_t class_count = small_size / alignment;
+
+	//下标为 size / alignment - 1
+	static constexpr auto size_class_info = [] {
+		std::array<SizeClassInfo, class_count> info{};
+		for (size_t i = 0; i != class_count; ++i) {
+			info[i] = { (i + 1) * alignment, page_size / ((i + 1) * alignment) };
+		}
+		return info;
+	}();
+
+	static_assert(page_size * 2 < large_size);
+
+	//page map 中每页的值，低 2 位为类型：slab 在高位存放 size class；大块内存只记录首页，高位存放页对齐的大小，其间存放请求的 log2(align)，向 ChunkSource 申请时的对齐为它与 page_size 中较大者
+	enum PageKind : std::uintptr_t {
+		none, //中等大小的块，由块头记录大小
+		slab,
+		large
+	};
+
+	static constexpr std::uintptr_t kind_mask = 3;
+
+	//中等大小的块前 align 字节中的最后 16 字节，offset 即 align
+	struct BlockHeader {
+		size_t size; //包括块头在内的整块大小
+		size_t offset; //返回的地址与整块起点之差
+	};
+
+	static_assert(sizeof(BlockHeader) == alignment);
+
+	//buffer 紧跟在 Chunk 之后
+	struct alignas(alignment) Chunk {
 		Chunk* next;
-		std::byte buffer[chunk_size];
+		size_t size; //包括 Chunk 本身
+
+		[[nodiscard]] constexpr std::byte* buffer() noexcept {
+			return reinterpret_cast<std::byte*>(this + 1);
+		}
+
+		[[nodiscard]] constexpr size_t capacity() const noexcept {
+			return size - sizeof(Chunk);
+		}
 	};
 
-	class FreeBlockList {
-		static constexpr size_t base_size = 16;
+	static_assert(MinChunkSize > sizeof(Chunk));
+
+	//最近回收的大块内存，回收时不立即还给 ChunkSource，以便同样大小的请求直接复用
+	struct LargeSpan {
+		void* buffer;
+		size_t size;
+		size_t align; //向 ChunkSource 申请时的对齐
+		bool decommitted;
+	};
+
+	static constexpr size_t large_cache_count = 16;
+	static constexpr size_t large_cache_bytes = MaxChunkSize * 8; //缓存的总字节数上限
+	static constexpr size_t large_cache_hot = 4; //最新的几块保留物理页，更早的交还物理页
+
+	//page map 与 HeapProfiler 的表不经过全局 operator new，以便用作进程的 malloc；有状态的 ChunkSource 不可复制，此时仍使用 NewChunkSource
+	using MetadataSource = std::conditional_t<std::is_empty_v<ChunkSource>, ChunkSource, NewChunkSource>;
 
+	//以 Tlsf.h 中的 TlsfIndex 按大小分类，另以 treap 按地址索引所有节点，回收时立即与相邻的空闲块合并
+	//节点就存放在空闲块的开头，插入与合并都不分配内存，因此每个空闲块至少有 min_size 字节
+	class FreeBlockList {
+		//节点的地址即空闲块的起点；各成员都有默认值，只给出部分成员的聚合初始化不会留下未初始化的指针
 		struct BlockNode {
-			void* buffer;
-			size_t size;
+			size_t size{};
+			BlockNode* prev_free{}; //同一分类中的双向链表
+			BlockNode* next_free{};
+			BlockNode* left{}; //按地址排序的 treap
+			BlockNode* right{};
+			size_t priority{};
 
-			[[nodiscard]] constexpr std::byte* begin() const noexcept {
-				return static_cast<std::byte*>(buffer);
+			[[nodiscard]] constexpr std::byte* begin() noexcept {
+				return reinterpret_cast<std::byte*>(this);
 			}
 
-			[[nodiscard]] constexpr std::byte* end() const noexcept {
+			[[nodiscard]] constexpr std::byte* end() noexcept {
 				return begin() + size;
 			}
 		};
 
-		BlockNode* list{};
+		TlsfIndex<BlockNode*> index{};
+		BlockNode* root{};
 		size_t count{};
-		size_t capacity{};
+		size_t bytes{}; //空闲字节总数
+		size_t seed{ 0x9e3779b97f4a7c15 };
 
 	public:
-		constexpr FreeBlockList() noexcept = default;
+		static constexpr size_t min_size = sizeof(BlockNode);
 
-		constexpr ~FreeBlockList() noexcept {
-			delete[](std::align_val_t{ sizeof(BlockNode) }, list);
-		}
+		static_assert(min_size % alignment == 0);
 
+		constexpr FreeBlockList() noexcept = default;
 
-		[[nodiscard]] constexpr void* allocate(size_t size) noexcept {
-			if (list == nullptr) {
+		//size 和 align 都是 alignment 的倍数；从空闲块的末尾切出，剩余的前部与尾部要么为空要么不小于 min_size
+		[[nodiscard]] constexpr void* allocate(size_t size, size_t align) {
+			BlockNode* node;
+			if (align == alignment) {
+				//size 所在分类的首个节点若恰好相等或足够大则直接使用，否则查找不小于 size + min_size 的节点
+				if (node = index.head(size); node == nullptr || (node->size != size && node->size < size + min_size)) {
+					if (node = index.find(size + min_size); node == nullptr) {
+						return nullptr;
+					}
+				}
+			} else if (node = index.find(size + align + min_size * 2); node == nullptr) {
 				return nullptr;
 			}
 
-			const auto target = std::lower_bound(
-					begin(), end(), BlockNode{ nullptr, size }, [](auto&& a, auto&& b) { return a.size < b.size; }
-			);
-			if (target == end()) {
-				return nullptr;
+			auto ret = reinterpret_cast<std::byte*>(reinterpret_cast<std::uintptr_t>(node->end() - size) & ~(align - 1));
+			auto tail = static_cast<size_t>(node->end() - (ret + size));
+			while (tail != 0 && tail < min_size) {
+				ret -= align;
+				tail += align;
 			}
 
-			if (target->size == size) {
-				std::copy(target + 1, end(), target);
+			Unlink(node);
+			bytes -= size;
+			if (ret == node->begin()) {
+				Erase(node);
 				--count;
 			} else {
-				Insert(begin(), target, { target->begin() + size, target->size - size });
+				//前部仍是原节点，地址不变，无需调整 treap
+				node->size = static_cast<size_t>(ret - node->begin());
+				Link(node);
 			}
-			return target->buffer;
+			if (tail != 0) {
+				bytes -= tail; //insert 会重新计入
+				insert(ret + size, tail);
+			}
+			return ret;
 		}
 
-		constexpr void insert(BlockNode block) {
-			if (list == nullptr) {
-				capacity = base_size;
-				list = new(std::align_val_t{ sizeof(BlockNode) }) BlockNode[capacity]{ block };
-				count = 1;
-				return;
+		//size 不小于 min_size，除非 [buffer, buffer + size) 与某个空闲块首尾相接
+		constexpr void insert(void* buffer, size_t size) noexcept {
+			const auto begin = static_cast<std::byte*>(buffer);
+			bytes += size;
+			BlockNode* prev = nullptr;
+			BlockNode* next = nullptr;
+			BlockNode** next_link = nullptr;
+			for (auto link = &root; *link != nullptr;) {
+				if (const auto it = *link; it->begin() < begin) {
+					prev = it;
+					link = &it->right;
+				} else {
+					next = it;
+					next_link = link;
+					link = &it->left;
+				}
 			}
 
-			if (count < capacity) {
-				Insert(begin(), end(), block);
+			const auto merge_prev = prev != nullptr && prev->end() == begin;
+			const auto merge_next = next != nullptr && next->begin() == begin + size;
+			if (merge_prev) {
+				Unlink(prev);
+				prev->size += size;
+				if (merge_next) {
+					Unlink(next);
+					prev->size += next->size;
+					Erase(next);
+					--count;
+				}
+				Link(prev);
+			} else if (merge_next) {
+				//节点移到新的起点，在 treap 中的位置不变
+				Unlink(next);
+				const auto moved = *next;
+				const auto node = std::construct_at(reinterpret_cast<BlockNode*>(begin), moved);
+				node->size += size;
+				*next_link = node;
+				Link(node);
+			} else {
+				const auto node = std::construct_at(reinterpret_cast<BlockNode*>(begin), BlockNode{ size, nullptr, nullptr, nullptr, nullptr, Random() });
+				Insert(node);
+				Link(node);
 				++count;
-				return;
 			}
+		}
 
-			capacity += capacity / 2;
-			const auto new_list = new(std::align_val_t{ sizeof(BlockNode) }) BlockNode[capacity];
-			auto new_count = 0;
+		//若 [buffer, buffer + size) 恰好是一个空闲块则将其取出
+		[[nodiscard]] constexpr bool take(void* buffer, size_t size) noexcept {
+			const auto link = Find(buffer);
+			const auto node = *link;
+			if (node == nullptr || node->size != size) {
+				return false;
+			}
 
-			std::sort(begin(), end(), [](auto&& a, auto&& b) { return a.buffer < b.buffer; });
-			auto it = begin();
-			do {
-				auto node = *it;
-				for (++it; it != end() && it->begin() == node.end(); ++it) {
-					node.size += it->size;
-				}
-				Insert(new_list, new_list + new_count, node);
-				++new_count;
-			} while (it != end());
+			Unlink(node);
+			*link = Merge(node->left, node->right);
+			--count;
+			bytes -= size;
+			return true;
+		}
+
+		//若有空闲块恰好从 buffer 开始，且取出开头的 size 字节后剩余为空或不小于 min_size，则将其取出
+		[[nodiscard]] constexpr bool take_front(void* buffer, size_t size) noexcept {
+			const auto link = Find(buffer);
+			const auto node = *link;
+			if (node == nullptr || (node->size != size && node->size < size + min_size)) {
+				return false;
+			}
+
+			Unlink(node);
+			if (node->size == size) {
+				*link = Merge(node->left, node->right);
+				--count;
+			} else {
+				//节点移到剩余部分的起点，在 treap 中的位置不变
+				auto moved = *node;
+				moved.size -= size;
+				*link = std::construct_at(reinterpret_cast<BlockNode*>(node->begin() + size), moved);
+				Link(*link);
+			}
+			bytes -= size;
+			return true;
+		}
+
+		//按地址顺序访问所有空闲块，f 的参数为空闲块中节点之后的部分
+		template <typename F>
+		constexpr void for_each(F&& f) {
+			Visit(root, f);
+		}
+
+		[[nodiscard]] constexpr size_t free_bytes() const noexcept {
+			return bytes;
+		}
 
-			delete[](std::align_val_t{ sizeof(BlockNode) }, list);
-			list = new_list;
-			count = new_count;
+		[[nodiscard]] constexpr size_t size() const noexcept {
+			return count;
+		}
+
+		//只需扫描最大的非空分类
+		[[nodiscard]] constexpr size_t largest() const noexcept {
+			size_t ret = 0;
+			for (auto it = index.last(); it != nullptr; it = it->next_free) {
+				ret = std::max(ret, it->size);
+			}
+			return ret;
 		}
 
 	private:
-		[[nodiscard]] constexpr BlockNode* begin() const noexcept {
-			return list;
+		template <typename F>
+		static constexpr void Visit(BlockNode* tree, F& f) {
+			if (tree != nullptr) {
+				Visit(tree->left, f);
+				f(tree->begin() + min_size, tree->size - min_size);
+				Visit(tree->right, f);
+			}
+		}
+
+		static constexpr BlockNode* Self(BlockNode* node) noexcept {
+			return node;
+		}
+
+		constexpr void Link(BlockNode* node) noexcept {
+			index.link(node, node->size, Self);
 		}
 
-		[[nodiscard]] constexpr BlockNode* end() const noexcept {
-			return list + count;
+		constexpr void Unlink(BlockNode* node) noexcept {
+			index.unlink(node, node->size, Self);
 		}
 
-		static constexpr void Insert(BlockNode* first, BlockNode* last, BlockNode block) noexcept {
-			const auto index = std::upper_bound(first, last, block, [](auto&& a, auto&& b) { return a.size < b.size; });
-			std::copy(index, last, index + 1);
-			*index = block;
+		[[nodiscard]] constexpr size_t Random() noexcept {
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			return seed;
+		}
+
+		constexpr void Insert(BlockNode* node) noexcept {
+			auto link = &root;
+			while (*link != nullptr && (*link)->priority >= node->priority) {
+				link = node->begin() < (*link)->begin() ? &(*link)->left : &(*link)->right;
+			}
+			Split(*link, node->begin(), node->left, node->right);
+			*link = node;
+		}
+
+		constexpr void Erase(BlockNode* node) noexcept {
+			const auto link = Find(node);
+			*link = Merge(node->left, node->right);
+		}
+
+		//返回指向地址为 buffer 的节点的链接，不存在时链接为 nullptr
+		[[nodiscard]] constexpr BlockNode** Find(void* buffer) noexcept {
+			auto link = &root;
+			while (*link != nullptr && (*link)->begin() != buffer) {
+				link = static_cast<std::byte*>(buffer) < (*link)->begin() ? &(*link)->left : &(*link)->right;
+			}
+			return link;
+		}
+
+		//按地址将 tree 拆为小于 key 的 left 与不小于 key 的 right
+		static constexpr void Split(BlockNode* tree, std::byte* key, BlockNode*& left, BlockNode*& right) noexcept {
+			if (tree == nullptr) {
+				left = right = nullptr;
+			} else if (tree->begin() < key) {
+				Split(tree->right, key, tree->right, right);
+				left = tree;
+			} else {
+				Split(tree->left, key, left, tree->left);
+				right = tree;
+			}
+		}
+
+		//left 中的地址均小于 right
+		[[nodiscard]] static constexpr BlockNode* Merge(BlockNode* left, BlockNode* right) noexcept {
+			if (left == nullptr || right == nullptr) {
+				return left != nullptr ? left : right;
+			}
+			if (left->priority >= right->priority) {
+				left->right = Merge(left->right, right);
+				return left;
+			}
+			right->left = Merge(left, right->left);
+			return right;
 		}
 	};
 
 
+	static constexpr size_t min_free_size = FreeBlockList::min_size;
+
+
+	//与 Allocator 相同的单链表，块本身存放 next
+	struct FreeObject {
+		FreeObject* next;
+	};
+
+	struct SizeClass {
+		FreeObject* head{};
+		size_t count{};
+	};
+
 	Chunk* chunk_head{};
 	FreeBlockList free_block_list{};
-
-	constexpr MemoryPool() noexcept = default;
+	SizeClass size_classes[class_count]{};
+	PageMap<MetadataSource> page_map{};
+	size_t cached_bytes{}; //size class 空闲链表中的字节数
+	size_t next_chunk_size{ MinChunkSize };
+	size_t trim_threshold{ std::numeric_limits<size_t>::max() };
+	size_t next_trim{ std::numeric_limits<size_t>::max() };
+	size_t chunk_count{};
+	size_t chunk_bytes{};
+	size_t large_count{};
+	size_t large_bytes{};
+	LargeSpan large_spans[large_cache_count]{}; //按回收顺序排列，越靠后越新
+	size_t large_span_count{};
+	size_t large_cached_bytes{};
+	RemoteFreeList remote_free_list; //其他线程回收的块，下次分配或 trim 时取回
+	[[no_unique_address]] ChunkSource chunk_source{};
+	[[no_unique_address]] PoolCounters counters{};
+	[[no_unique_address]] HeapProfiler<MetadataSource> profiler{};
 
 public:
-	MemoryPool(const MemoryPool&) = delete;
-	MemoryPool& operator=(const MemoryPool&) = delete;
+	//每个实例都是独立的堆，各自持有 chunk、大块内存与 page map，可按租户、请求或线程分别创建
+	constexpr BasicMemoryPool() noexcept = default;
+
+	//有状态的 ChunkSource 各自对应一个独立的内存池
+	constexpr explicit BasicMemoryPool(ChunkSource chunk_source) noexcept: chunk_source(std::move(chunk_source)) {}
+
+	BasicMemoryPool(const BasicMemoryPool&) = delete;
+	BasicMemoryPool& operator=(const BasicMemoryPool&) = delete;
 
 
-	constexpr ~MemoryPool() noexcept {
+	//整体释放：仍在使用中的块不必逐个回收，中小块随 chunk 一起释放，大块内存由 page map 中首页的记录找出后归还
+	constexpr ~BasicMemoryPool() noexcept {
+		ReleaseLargeSpans();
+		page_map.for_each([this](void* p, std::uintptr_t entry) {
+			if ((entry & kind_mask) == large) {
+				const auto size = entry & ~(page_size - 1);
+				if constexpr (memory_debug::enabled) {
+					memory_debug::unpoison(p, size);
+				}
+				chunk_source.deallocate(p, size, std::max(LargeAlignment(entry), page_size));
+			}
+		});
 		while (chunk_head != nullptr) {
-			delete[] std::exchange(chunk_head, chunk_head->next);
+			const auto chunk = std::exchange(chunk_head, chunk_head->next);
+			if constexpr (memory_debug::enabled) {
+				memory_debug::unpoison(chunk, chunk->size);
+			}
+			chunk_source.deallocate(chunk, chunk->size, page_size);
 		}
 	}
 
-	static MemoryPool& instance() noexcept {
-		static MemoryPool inst;
+	static BasicMemoryPool& instance() noexcept {
+		static BasicMemoryPool inst;
 		return inst;
 	}
 
+private:
+	//超过此值的大小或对齐不可能满足；不超过时加上 redzone、块头与对齐再取整到页都不会溢出
+	static constexpr size_t max_request = std::numeric_limits<size_t>::max() >> 2;
+
+	//须在取整之前检查
+	[[nodiscard]] static constexpr bool IsSatisfiable(size_t size, size_t align) noexcept {
+		return size <= max_request && align <= max_request;
+	}
+
+	[[nodiscard]] static constexpr size_t RoundUp(size_t size) noexcept {
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+
+	[[nodiscard]] static constexpr size_t PageRoundUp(size_t size) noexcept {
+		return (size + page_size - 1) & ~(page_size - 1);
+	}
+
+	//中等大小的块需要额外的 align 字节存放块头
+	[[nodiscard]] static constexpr bool IsLarge(size_t size, size_t align) noexcept {
+		return size + align >= large_size;
+	}
+
+	//size 和 align 均已调整过
+	[[nodiscard]] static constexpr bool IsSmall(size_t size, size_t align) noexcept {
+		return size <= small_size && align == alignment;
+	}
+
+	[[nodiscard]] static constexpr size_t ClassIndex(size_t size) noexcept {
+		return size / alignment - 1;
+	}
+
+	[[nodiscard]] static constexpr BlockHeader& Header(void* p) noexcept {
+		return *(static_cast<BlockHeader*>(p) - 1);
+	}
+
+	[[nodiscard]] constexpr size_t FreeBytes() const noexcept {
+		return free_block_list.free_bytes() + cached_bytes;
+	}
+
+	//新 chunk 至少能容纳 bytes 字节，之后的 chunk 大小翻倍；失败时返回 nullptr
+	[[nodiscard]] constexpr Chunk* NewChunk(size_t bytes) noexcept {
+		const auto size = std::max(next_chunk_size, std::bit_ceil(bytes + sizeof(Chunk)));
+		const auto buffer = TryAllocateChunk(chunk_source, size, page_size);
+		if (buffer == nullptr) {
+			return nullptr;
+		}
+		next_chunk_size = std::min(next_chunk_size * 2, MaxChunkSize);
+		chunk_head = new(buffer) Chunk{ chunk_head, size };
+		++chunk_count;
+		chunk_bytes += size;
+		counters.add(PoolEvent::new_chunk);
+		return chunk_head;
+	}
+
+	[[nodiscard]] static constexpr size_t LargeAlignment(std::uintptr_t entry) noexcept {
+		return size_t{ 1 } << ((entry >> 2) & 63);
+	}
+
+	//大块内存独占整页，首页记录大小和请求的对齐；优先从最新的开始查找页数与向 ChunkSource 申请时的对齐都相同的缓存，回收时由请求的对齐还原出后者
+	//失败时返回 nullptr；缓存的页在 page map 中已有节点，重新写入不会失败
+	[[nodiscard]] constexpr void* AllocateLarge(size_t size, size_t align) noexcept {
+		size = PageRoundUp(size);
+		const auto entry = size | std::countr_zero(align) << 2 | large;
+		align = std::max(align, page_size);
+		for (auto i = large_span_count; i-- != 0;) {
+			const auto span = large_spans[i];
+			if (span.size == size && span.align == align) {
+				static_cast<void>(page_map.try_set(span.buffer, 1, entry));
+				std::copy(large_spans + i + 1, large_spans + large_span_count, large_spans + i);
+				--large_span_count;
+				large_cached_bytes -= size;
+				++large_count;
+				large_bytes += size;
+				counters.add(PoolEvent::large_reuse);
+				return span.buffer;
+			}
+		}
+
+		const auto ret = TryAllocateChunk(chunk_source, size, align);
+		if (ret == nullptr) {
+			return nullptr;
+		}
+		if (!page_map.try_set(ret, 1, entry)) {
+			chunk_source.deallocate(ret, size, align);
+			return nullptr;
+		}
+		++large_count;
+		large_bytes += size;
+		counters.add(PoolEvent::large_allocate);
+		return ret;
+	}
+
+	//放入缓存，超出数量或字节数上限时先将最早的还给 ChunkSource
+	constexpr void DeallocateLarge(void* p, std::uintptr_t entry) noexcept {
+		const LargeSpan span{ p, entry & ~(page_size - 1), std::max(LargeAlignment(entry), page_size), false };
+		page_map.set(p, 1, none);
+		--large_count;
+		large_bytes -= span.size;
+		counters.add(PoolEvent::large_deallocate);
+
+		if (span.size > large_cache_bytes) {
+			chunk_source.deallocate(span.buffer, span.size, span.align);
+			return;
+		}
+		size_t evict = 0;
+		while (large_span_count - evict == large_cache_count || large_cached_bytes + span.size > large_cache_bytes) {
+			const auto& oldest = large_spans[evict++];
+			large_cached_bytes -= oldest.size;
+			if constexpr (memory_debug::enabled) {
+				memory_debug::unpoison(oldest.buffer, oldest.size);
+			}
+			chunk_source.deallocate(oldest.buffer, oldest.size, oldest.align);
+		}
+		std::copy(large_spans + evict, large_spans + large_span_count, large_spans);
+		large_span_count -= evict;
+		large_spans[large_span_count++] = span;
+		large_cached_bytes += span.size;
+		if constexpr (memory_debug::enabled) {
+			memory_debug::poison(span.buffer, span.size);
+		}
+
+		//延迟交还物理页：只有不再是最新几块的缓存才 decommit，刚回收的块被复用时无需重新缺页
+		if constexpr (requires(void* buffer, size_t size) { chunk_source.decommit(buffer, size); }) {
+			for (size_t i = 0; i + large_cache_hot < large_span_count; ++i) {
+				if (!large_spans[i].decommitted) {
+					chunk_source.decommit(large_spans[i].buffer, large_spans[i].size);
+					large_spans[i].decommitted = true;
+				}
+			}
+		}
+	}
+
+	//返回归还的字节数
+	constexpr size_t ReleaseLargeSpans() noexcept {
+		const auto released = large_cached_bytes;
+		for (size_t i = 0; i != large_span_count; ++i) {
+			if constexpr (memory_debug::enabled) {
+				memory_debug::unpoison(large_spans[i].buffer, large_spans[i].size);
+			}
+			chunk_source.deallocate(large_spans[i].buffer, large_spans[i].size, large_spans[i].align);
+		}
+		large_span_count = 0;
+		large_cached_bytes = 0;
+		return released;
+	}
+
+	//返回的地址之前 align 字节用于存放块头，失败时返回 nullptr
+	[[nodiscard]] constexpr void* AllocateMedium(size_t size, size_t align) noexcept {
+		const auto block = static_cast<std::byte*>(AllocateBlock(size + align, align));
+		if (block == nullptr) {
+			return nullptr;
+		}
+		const auto ret = block + align;
+		Header(ret) = { size + align, align };
+		return ret;
+	}
+
+	constexpr void DeallocateMedium(void* p) {
+		const auto [size, offset] = Header(p);
+		Release(static_cast<std::byte*>(p) - offset, size);
+	}
+
+	//失败时返回 nullptr
+	[[nodiscard]] constexpr void* AllocateSmall(size_t index) {
+		auto& size_class = size_classes[index];
+		if (size_class.head == nullptr && !Refill(index)) {
+			return nullptr;
+		}
+		--size_class.count;
+		cached_bytes -= size_class_info[index].size;
+		const auto ret = std::exchange(size_class.head, size_class.head->next);
+		if constexpr (memory_debug::enabled) {
+			memory_debug::unpoison_defined(ret, size_class_info[index].size);
+			memory_debug::check(ret + 1, size_class_info[index].size - sizeof(FreeObject), memory_debug::freed_byte, "A freed block is modified.");
+		}
+		return ret;
+	}
+
+	constexpr void DeallocateSmall(void* p, size_t index) noexcept {
+		auto& size_class = size_classes[index];
+		size_class.head = new(p) FreeObject{ size_class.head };
+		++size_class.count;
+		cached_bytes += size_class_info[index].size;
+		if constexpr (memory_debug::enabled) {
+			PoisonObject(size_class.head, size_class_info[index].size);
+		}
+	}
+
+	//MEMORY_MANAGER_DEBUG 为 1 时，空闲的小对象中 next 之后的部分标记为不可访问，内容已在回收时填满 freed_byte
+	static void PoisonObject(FreeObject* object, size_t size) noexcept {
+		memory_debug::poison(object + 1, size - sizeof(FreeObject));
+	}
+
+	//从 FreeBlockList 切出一页作为 slab，等分后挂到链表上；失败时返回 false
+	[[nodiscard]] constexpr bool Refill(size_t index) noexcept {
+		const auto [size, batch_count] = size_class_info[index];
+		const auto buffer = static_cast<std::byte*>(AllocateBlock(page_size, page_size));
+		if (buffer == nullptr) {
+			return false;
+		}
+		if (!page_map.try_set(buffer, page_size, index << 2 | slab)) {
+			Release(buffer, page_size);
+			return false;
+		}
+
+		auto& size_class = size_classes[index];
+		if constexpr (memory_debug::enabled) {
+			memory_debug::fill(buffer, page_size, memory_debug::freed_byte);
+		}
+		for (auto it = buffer + size * batch_count; it != buffer;) {
+			it -= size;
+			size_class.head = new(it) FreeObject{ size_class.head };
+			if constexpr (memory_debug::enabled) {
+				PoisonObject(size_class.head, size);
+			}
+		}
+		size_class.count += batch_count;
+		cached_bytes += size * batch_count;
+		return true;
+	}
+
+	//按地址排序各 size class 的空闲块，完全空闲的 slab 还给 FreeBlockList，其余按地址顺序重新串起来
+	constexpr void TrimSlabs() {
+		for (size_t index = 0; index != class_count; ++index) {
+			const auto [size, batch_count] = size_class_info[index];
+			auto& size_class = size_classes[index];
+			auto it = Sort(size_class.head);
+			auto link = &size_class.head;
+			while (it != nullptr) {
+				const auto page = reinterpret_cast<std::byte*>(reinterpret_cast<std::uintptr_t>(it) & ~(page_size - 1));
+				const auto first = it;
+				auto last = it;
+				size_t n = 0;
+				for (; it != nullptr && reinterpret_cast<std::byte*>(it) < page + page_size; it = it->next) {
+					last = it;
+					++n;
+				}
+				if (n == batch_count) {
+					page_map.set(page, page_size, none);
+					if constexpr (memory_debug::enabled) {
+						memory_debug::unpoison(page, page_size);
+					}
+					Release(page, page_size);
+					size_class.count -= batch_count;
+					cached_bytes -= size * batch_count;
+				} else {
+					*link = first;
+					link = &last->next;
+				}
+			}
+			*link = nullptr;
+		}
+	}
+
+	//自底向上的链表归并排序，不分配内存
+	[[nodiscard]] static constexpr FreeObject* Sort(FreeObject* head) noexcept {
+		for (size_t width = 1; ; width *= 2) {
+			FreeObject* ret = nullptr;
+			auto tail = &ret;
+			size_t merges = 0;
+			while (head != nullptr) {
+				++merges;
+				auto left = head;
+				auto right = head;
+				for (size_t i = 0; i != width && right != nullptr; ++i) {
+					right = right->next;
+				}
+				auto rest = right;
+				for (size_t i = 0; i != width && rest != nullptr; ++i) {
+					rest = rest->next;
+				}
+
+				//left 与 right 各自最多 width 个，以 right 与 rest 为界
+				auto left_end = right;
+				auto right_end = rest;
+				while (left != left_end || right != right_end) {
+					if (right == right_end || (left != left_end && left < right)) {
+						*tail = left;
+						left = left->next;
+					} else {
+						*tail = right;
+						right = right->next;
+					}
+					tail = &(*tail)->next;
+				}
+				head = rest;
+			}
+			*tail = nullptr;
+			if (merges <= 1) {
+				return ret;
+			}
+			head = ret;
+		}
+	}
+
+	//在 FreeBlockList 中查找，不够时申请新 chunk，失败时返回 nullptr
+	[[nodiscard]] constexpr void* AllocateBlock(size_t size, size_t align) noexcept {
+		if (const auto ret = free_block_list.allocate(size, align); ret != nullptr) {
+			return ret;
+		}
+
+		//前部空隙与尾部都要么为空要么能存放 FreeBlockList 的节点
+		const auto chunk = NewChunk(size + (align == alignment ? min_free_size : align + min_free_size * 2));
+		if (chunk == nullptr) {
+			return nullptr;
+		}
+		const auto buffer = chunk->buffer();
+		auto ret = buffer + (-reinterpret_cast<std::uintptr_t>(buffer) & (align - 1));
+		while (ret != buffer && static_cast<size_t>(ret - buffer) < min_free_size) {
+			ret += align;
+		}
+		if (ret != buffer) {
+			Release(buffer, static_cast<size_t>(ret - buffer));
+		}
+		if (const auto tail = buffer + chunk->capacity() - (ret + size); tail != 0) {
+			Release(ret + size, static_cast<size_t>(tail));
+		}
+		return ret;
+	}
+
+	//回收一段空闲内存，合并次数等于空闲块数应增加而未增加的部分
+	constexpr void Release(std::byte* buffer, size_t size) noexcept {
+		const auto before = free_block_list.size();
+		free_block_list.insert(buffer, size);
+		counters.add(PoolEvent::merge, before + 1 - free_block_list.size());
+	}
+
+	//size 和 align 均已调整过
+	[[nodiscard]] constexpr bool Matches(void* p, size_t size, size_t align) const noexcept {
+		const auto entry = page_map.get(p);
+		switch (entry & kind_mask) {
+			case slab:
+				return IsSmall(size, align) && (entry >> 2) == ClassIndex(size);
+			case large:
+				return IsLarge(size, align) && (entry & ~(page_size - 1)) == PageRoundUp(size);
+			default:
+				return !IsSmall(size, align) && !IsLarge(size, align) && Header(p).offset == align && Header(p).size == size + align;
+		}
+	}
+
+	//分配时请求的对齐：大块内存记录在 page map 中，块头的 offset 即为 align
+	[[nodiscard]] constexpr size_t Alignment(void* p) const noexcept {
+		const auto entry = page_map.get(p);
+		switch (entry & kind_mask) {
+			case slab:
+				return alignment;
+			case large:
+				return LargeAlignment(entry);
+			default:
+				return Header(p).offset;
+		}
+	}
+
+	//size 和 align 均已调整过，p 的对齐满足 align。仍属于同一类别时原地调整：
+	//小对象须在同一 size class，大块内存须占同样多的页，中等大小的块扩大时取出紧随其后的空闲块的开头，缩小时把尾部还给 FreeBlockList
+	[[nodiscard]] constexpr bool Resize(void* p, size_t size, size_t align) {
+		const auto entry = page_map.get(p);
+		switch (entry & kind_mask) {
+			case slab:
+				if (!IsSmall(size, align) || (entry >> 2) != ClassIndex(size)) {
+					return false;
+				}
+				break;
+			case large:
+				if (!IsLarge(size, align) || (entry & ~(page_size - 1)) != PageRoundUp(size)) {
+					return false;
+				}
+				break;
+			default: {
+				if (IsSmall(size, align) || IsLarge(size, align)) {
+					return false;
+				}
+				auto& header = Header(p);
+				const auto end = static_cast<std::byte*>(p) - header.offset + header.size;
+				const auto block_size = size + header.offset;
+				if (block_size > header.size) {
+					if (!free_block_list.take_front(end, block_size - header.size)) {
+						return false;
+					}
+					header.size = block_size;
+				} else if (block_size < header.size) {
+					//尾部不足以存放空闲块的节点时不缩小
+					const auto tail = header.size - block_size;
+					if (tail < min_free_size) {
+						return false;
+					}
+					header.size = block_size;
+					Release(end - tail, tail);
+					AutoTrim();
+				}
+				break;
+			}
+		}
+		counters.add(PoolEvent::resize);
+		return true;
+	}
+
+	//MEMORY_MANAGER_DEBUG 为 1 时先校验并取下 redzone，无论成功与否都按调整后的大小重新写入；new_size 过大时不可能原地调整
+	[[nodiscard]] constexpr bool Expand(void* p, size_t new_size, size_t align) {
+		if (new_size > max_request) {
+			return false;
+		}
+		if constexpr (memory_debug::enabled) {
+			const auto old_size = memory_debug::unguard(p, UsableSize(p));
+			const auto ret = Resize(p, RoundUp(new_size + memory_debug::redzone_size), align);
+			memory_debug::guard(p, ret ? new_size : old_size, UsableSize(p));
+			return ret;
+		}
+		return Resize(p, RoundUp(new_size), align);
+	}
+
+	//MEMORY_POOL_CHECK_SIZE 为 1 时校验新块仍满足 align，大块内存的对齐取自 page map 中记录的请求；失败时返回 nullptr，p 保持不变
+	[[nodiscard]] constexpr void* Reallocate(void* p, size_t old_size, size_t new_size, size_t align) {
+		if (Expand(p, new_size, align)) {
+			return p;
+		}
+		const auto ret = TryAllocate(new_size, align);
+		if (ret == nullptr) {
+			return nullptr;
+		}
+		std::copy_n(static_cast<const std::byte*>(p), std::min(old_size, new_size), static_cast<std::byte*>(ret));
+		deallocate(p);
+#if MEMORY_POOL_CHECK_SIZE
+		if ((reinterpret_cast<std::uintptr_t>(ret) & (align - 1)) != 0 || Alignment(ret) < align) {
+			throw std::runtime_error("The reallocated block does not keep its alignment.");
+		}
+#endif
+		return ret;
+	}
+
+	//由 page map 和块头查出大小，不自动 trim
+	constexpr void Deallocate(void* p) {
+		profiler.on_deallocate(p);
+		const auto entry = page_map.get(p);
+		switch (entry & kind_mask) {
+			case slab:
+				counters.add(PoolEvent::deallocate);
+				DeallocateSmall(p, entry >> 2);
+				break;
+			case large:
+				DeallocateLarge(p, entry);
+				break;
+			default:
+				counters.add(PoolEvent::deallocate);
+				DeallocateMedium(p);
+				break;
+		}
+	}
+
+	constexpr void DrainRemote() {
+		if (remote_free_list.empty()) {
+			return;
+		}
+		counters.add(PoolEvent::remote_deallocate, remote_free_list.drain([this](void* p) { Deallocate(p); }));
+		AutoTrim();
+	}
+
+	constexpr void AutoTrim() {
+		if (FreeBytes() >= next_trim) {
+			trim();
+		}
+	}
+
+	[[nodiscard]] constexpr size_t UsableSize(void* p) const noexcept {
+		const auto entry = page_map.get(p);
+		switch (entry & kind_mask) {
+			case slab:
+				return size_class_info[entry >> 2].size;
+			case large:
+				return entry & ~(page_size - 1);
+			default:
+				return Header(p).size - Header(p).offset;
+		}
+	}
+
+	//MEMORY_MANAGER_DEBUG 为 1 时在回收之前校验 redzone 并以 freed_byte 填满
+	constexpr void Scrub(void* p) {
+		if constexpr (memory_debug::enabled) {
+			memory_debug::release(p, UsableSize(p));
+		}
+	}
+
+	//size 不为 0 且 IsSatisfiable，失败时返回 nullptr
+	[[nodiscard]] constexpr void* Allocate(size_t size, size_t align) {
+		DrainRemote();
+		size = RoundUp(size);
+		align = std::max(align, alignment);
+		counters.record(std::bit_width(size - 1));
+		if (IsLarge(size, align)) {
+			return AllocateLarge(size, align);
+		}
+
+		counters.add(PoolEvent::allocate);
+		return IsSmall(size, align) ? AllocateSmall(ClassIndex(size)) : AllocateMedium(size, align);
+	}
+
+	//size 不为 0，失败时返回 nullptr；MEMORY_MANAGER_DEBUG 为 1 时多申请 redzone，其后写入 guard
+	[[nodiscard]] constexpr void* TryAllocate(size_t size, size_t align) {
+		if (!IsSatisfiable(size, align)) {
+			return nullptr;
+		}
+		const auto ret = Allocate(size + memory_debug::redzone_size, align);
+		if (ret == nullptr) {
+			return nullptr;
+		}
+		if constexpr (memory_debug::enabled) {
+			memory_debug::guard(ret, size, UsableSize(ret));
+		}
+		profiler.on_allocate(ret, size);
+		return ret;
+	}
+
+	//返回写入 out 的个数，之后的分配失败
+	[[nodiscard]] constexpr size_t AllocateN(size_t size, size_t count, void** out, size_t align) {
+		const auto first = out;
+		if (!IsSatisfiable(size, align)) {
+			return 0;
+		}
+		if constexpr (memory_debug::enabled) {
+			for (; count != 0 && (*out = TryAllocate(size, align)) != nullptr; --count) {
+				++out;
+			}
+			return static_cast<size_t>(out - first);
+		}
+
+		DrainRemote();
+		size = RoundUp(size);
+		align = std::max(align, alignment);
+		if (IsSmall(size, align)) {
+			counters.record(std::bit_width(size - 1), count);
+			counters.add(PoolEvent::allocate, count);
+			for (; count != 0 && (*out = AllocateSmall(ClassIndex(size))) != nullptr; --count) {
+				profiler.on_allocate(*out++, size);
+			}
+			return static_cast<size_t>(out - first);
+		}
+
+		if (size % align != 0 || IsLarge(size, align)) {
+			for (; count != 0 && (*out = TryAllocate(size, align)) != nullptr; --count) {
+				++out;
+			}
+			return static_cast<size_t>(out - first);
+		}
+
+		const auto stride = size + align;
+		const auto batch = (large_size - 1) / stride;
+		counters.record(std::bit_width(size - 1), count);
+		while (count != 0) {
+			const auto n = std::min(count, batch);
+			const auto block = static_cast<std::byte*>(AllocateBlock(stride * n, align));
+			if (block == nullptr) {
+				break;
+			}
+			counters.add(PoolEvent::allocate, n);
+			auto p = block + align;
+			for (const auto last = out + n; out != last; ++out, p += stride) {
+				Header(p) = { stride, align };
+				*out = p;
+				profiler.on_allocate(p, size);
+			}
+			count -= n;
+		}
+		return static_cast<size_t>(out - first);
+	}
+
 public:
-	[[nodiscard, gnu::alloc_size(2)]] constexpr void* allocate(size_t size) {
+	//align 须为 2 的幂；失败时抛出 std::bad_alloc
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] constexpr void* allocate(size_t size, size_t align = alignment) {
 		if (size == 0) {
 			return nullptr;
 		}
+		const auto ret = TryAllocate(size, align);
+		if (ret == nullptr) {
+			throw std::bad_alloc();
+		}
+		return ret;
+	}
 
-		if (size >= chunk_size) {
-			return new std::byte[size];
+	//失败时返回 nullptr 而不抛出异常，可在持有锁时调用，不会因构造异常对象而重入 malloc
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] constexpr void* try_allocate(size_t size, size_t align = alignment) noexcept {
+		return size != 0 ? TryAllocate(size, align) : nullptr;
+	}
+
+	[[nodiscard, gnu::alloc_size(2)]] constexpr void* allocate(size_t size, std::align_val_t align) {
+		return allocate(size, static_cast<size_t>(align));
+	}
+
+	//由 page map 和块头查出大小，O(1)
+	constexpr void deallocate(void* p) {
+		if (p == nullptr) {
+			return;
 		}
+		Scrub(p);
+		Deallocate(p);
+		AutoTrim();
+	}
 
-		if (const auto ret = free_block_list.allocate(size); ret != nullptr) {
-			return ret;
+	//可在任意线程调用，与所有者的其他操作并发，只以一次 CAS 压入 RemoteFreeList；块在下次 allocate、allocate_n 或 trim 时才真正回收
+	void deallocate_remote(void* p) noexcept {
+		if (p != nullptr) {
+			Scrub(p);
+			remote_free_list.push(p);
 		}
+	}
 
-		chunk_head = new Chunk{ chunk_head };
-		free_block_list.insert({ chunk_head->buffer + size, chunk_size - size });
-		return chunk_head->buffer;
+	//ps 中不能有 nullptr，整批以一次 CAS 压入
+	void deallocate_remote_n(std::span<void* const> ps) noexcept {
+		if constexpr (memory_debug::enabled) {
+			std::for_each(ps.begin(), ps.end(), [this](void* p) { Scrub(p); });
+		}
+		remote_free_list.push(ps);
 	}
 
-	constexpr void deallocate(void* p, size_t size) {
+	//size 和 align 作为提示，小对象据此省去查找 page map；MEMORY_POOL_CHECK_SIZE 为 1 时校验两者与分配时相同
+	constexpr void deallocate(void* p, size_t size, size_t align = alignment) {
 		if (p == nullptr || size == 0) {
 			return;
 		}
 
-		if (size >= chunk_size) {
-			operator delete[](p);
+		size = RoundUp(size + memory_debug::redzone_size);
+		align = std::max(align, alignment);
+#if MEMORY_POOL_CHECK_SIZE
+		if (!Matches(p, size, align)) {
+			throw std::runtime_error("The size does not match the allocation.");
+		}
+#endif
+
+		Scrub(p);
+		profiler.on_deallocate(p);
+		if (IsLarge(size, align)) {
+			DeallocateLarge(p, page_map.get(p));
+			return;
+		}
+
+		counters.add(PoolEvent::deallocate);
+		if (IsSmall(size, align)) {
+			DeallocateSmall(p, ClassIndex(size));
 		} else {
-			free_block_list.insert({ p, size });
+			DeallocateMedium(p);
 		}
+		AutoTrim();
+	}
+
+	constexpr void deallocate(void* p, size_t size, std::align_val_t align) {
+		deallocate(p, size, static_cast<size_t>(align));
+	}
+
+	//p 须由本内存池分配，原地调整为 new_size 字节，成功时返回 true，此后按 new_size 回收；失败时 p 不变
+	[[nodiscard]] constexpr bool try_expand(void* p, size_t new_size) {
+		if (p == nullptr || new_size == 0) {
+			return false;
+		}
+		return Expand(p, new_size, Alignment(p));
+	}
+
+	//old_size 和 align 为分配时的参数，MEMORY_POOL_CHECK_SIZE 为 1 时校验
+	[[nodiscard]] constexpr bool try_expand(void* p, size_t old_size, size_t new_size, size_t align = alignment) {
+		if (p == nullptr || new_size == 0) {
+			return false;
+		}
+
+		align = std::max(align, alignment);
+#if MEMORY_POOL_CHECK_SIZE
+		if (!Matches(p, RoundUp(old_size + memory_debug::redzone_size), align)) {
+			throw std::runtime_error("The size does not match the allocation.");
+		}
+#endif
+		return Expand(p, new_size, align);
+	}
+
+	//先尝试 try_expand，失败时重新分配并复制，保持分配时的对齐。p 为 nullptr 时等同于 allocate，new_size 为 0 时等同于 deallocate
+	[[nodiscard]] constexpr void* reallocate(void* p, size_t new_size) {
+		if (p == nullptr) {
+			return allocate(new_size);
+		}
+		if (new_size == 0) {
+			deallocate(p);
+			return nullptr;
+		}
+		const auto ret = Reallocate(p, usable_size(p), new_size, Alignment(p));
+		if (ret == nullptr) {
+			throw std::bad_alloc();
+		}
+		return ret;
+	}
+
+	//失败时返回 nullptr 而不抛出异常，p 保持不变
+	[[nodiscard]] constexpr void* try_reallocate(void* p, size_t new_size) noexcept {
+		if (p == nullptr) {
+			return try_allocate(new_size);
+		}
+		if (new_size == 0) {
+			deallocate(p);
+			return nullptr;
+		}
+		return Reallocate(p, usable_size(p), new_size, Alignment(p));
+	}
+
+	[[nodiscard]] constexpr void* reallocate(void* p, size_t old_size, size_t new_size, size_t align = alignment) {
+		if (p == nullptr) {
+			return allocate(new_size, align);
+		}
+		if (new_size == 0) {
+			deallocate(p, old_size, align);
+			return nullptr;
+		}
+
+		align = std::max(align, alignment);
+#if MEMORY_POOL_CHECK_SIZE
+		if (!Matches(p, RoundUp(old_size + memory_debug::redzone_size), align)) {
+			throw std::runtime_error("The size does not match the allocation.");
+		}
+#endif
+		const auto ret = Reallocate(p, old_size, new_size, align);
+		if (ret == nullptr) {
+			throw std::bad_alloc();
+		}
+		return ret;
+	}
+
+	//p 须由本内存池分配，返回实际可用的字节数；MEMORY_MANAGER_DEBUG 为 1 时即为请求的大小，之后是 redzone
+	[[nodiscard]] constexpr size_t usable_size(void* p) const noexcept {
+		if constexpr (memory_debug::enabled) {
+			return memory_debug::requested_size(p, UsableSize(p));
+		}
+		return UsableSize(p);
+	}
+
+	//小对象逐个从 size class 弹出；中等大小的块每批切出一段连续内存，每块各自带有块头；size 不是 align 的倍数时逐个分配
+	//失败时先回收已分配的块再抛出 std::bad_alloc
+	constexpr void allocate_n(size_t size, size_t count, void** out, size_t align = alignment) {
+		if (size == 0) {
+			std::fill_n(out, count, nullptr);
+			return;
+		}
+		if (const auto n = AllocateN(size, count, out, align); n != count) {
+			std::for_each(out, out + n, [this](void* p) { deallocate(p); });
+			throw std::bad_alloc();
+		}
+	}
+
+	//返回写入 out 的个数，少于 count 时之后的分配失败，不抛出异常
+	[[nodiscard]] constexpr size_t try_allocate_n(size_t size, size_t count, void** out, size_t align = alignment) noexcept {
+		if (size == 0) {
+			std::fill_n(out, count, nullptr);
+			return count;
+		}
+		return AllocateN(size, count, out, align);
+	}
+
+	//中等大小的块中地址连续的先拼接起来再一起回收
+	constexpr void deallocate_n(std::span<void* const> ps, size_t size, size_t align = alignment) {
+		if (size == 0) {
+			return;
+		}
+		if constexpr (memory_debug::enabled) {
+			std::for_each(ps.begin(), ps.end(), [&](void* p) { deallocate(p, size, align); });
+			return;
+		}
+
+		size = RoundUp(size);
+		align = std::max(align, alignment);
+#if MEMORY_POOL_CHECK_SIZE
+		for (const auto p : ps) {
+			if (p != nullptr && !Matches(p, size, align)) {
+				throw std::runtime_error("The size does not match the allocation.");
+			}
+		}
+#endif
+		for (const auto p : ps) {
+			profiler.on_deallocate(p);
+		}
+
+		if (IsLarge(size, align)) {
+			for (const auto p : ps) {
+				if (p != nullptr) {
+					DeallocateLarge(p, page_map.get(p));
+				}
+			}
+			return;
+		}
+
+		if (IsSmall(size, align)) {
+			for (const auto p : ps) {
+				if (p != nullptr) {
+					counters.add(PoolEvent::deallocate);
+					DeallocateSmall(p, ClassIndex(size));
+				}
+			}
+			AutoTrim();
+			return;
+		}
+
+		for (auto it = ps.begin(); it != ps.end();) {
+			if (*it == nullptr) {
+				++it;
+				continue;
+			}
+			const auto begin = static_cast<std::byte*>(*it) - Header(*it).offset;
+			auto end = begin + Header(*it).size;
+			size_t n = 1;
+			for (++it; it != ps.end() && *it != nullptr && static_cast<std::byte*>(*it) - Header(*it).offset == end; ++it, ++n) {
+				end += Header(*it).size;
+			}
+			counters.add(PoolEvent::deallocate, n);
+			Release(begin, static_cast<size_t>(end - begin));
+		}
+		AutoTrim();
 	}
 
 	template <typename T>
 	[[nodiscard]] constexpr T* allocate() {
-		return static_cast<T*>(allocate(sizeof(T)));
+		return static_cast<T*>(allocate(sizeof(T), alignof(T)));
 	}
 
 	template <typename T>
 	constexpr void deallocate(T* p) {
-		deallocate(p, sizeof(T));
+		deallocate(p, sizeof(T), alignof(T));
+	}
+
+	template <typename T>
+	constexpr void allocate_n(size_t count, T** out) {
+		allocate_n(sizeof(T), count, reinterpret_cast<void**>(out), alignof(T));
+	}
+
+	template <typename T>
+	constexpr void deallocate_n(std::span<T* const> ps) {
+		deallocate_n({ reinterpret_cast<void* const*>(ps.data()), ps.size() }, sizeof(T), alignof(T));
+	}
+
+	//将缓存的大块内存以及完全空闲的 slab 与 chunk 依次归还；ChunkSource 提供 decommit 时，其余较大的空闲块中节点之后的整页也交还物理页。返回归还的字节数
+	constexpr size_t trim() {
+		counters.add(PoolEvent::trim);
+		counters.add(PoolEvent::remote_deallocate, remote_free_list.drain([this](void* p) { Deallocate(p); }));
+		TrimSlabs();
+		auto released = ReleaseLargeSpans();
+		for (auto link = &chunk_head; *link != nullptr;) {
+			const auto chunk = *link;
+			if (free_block_list.take(chunk->buffer(), chunk->capacity())) {
+				*link = chunk->next;
+				released += chunk->size;
+				--chunk_count;
+				chunk_bytes -= chunk->size;
+				if constexpr (memory_debug::enabled) {
+					memory_debug::unpoison(chunk, chunk->size);
+				}
+				chunk_source.deallocate(chunk, chunk->size, page_size);
+			} else {
+				link = &chunk->next;
+			}
+		}
+
+		if constexpr (requires(void* p, size_t n) { chunk_source.decommit(p, n); }) {
+			free_block_list.for_each([this](void* buffer, size_t size) {
+				if (size >= decommit_size) {
+					chunk_source.decommit(buffer, size);
+				}
+			});
+		}
+
+		if (trim_threshold != std::numeric_limits<size_t>::max()) {
+			next_trim = FreeBytes() + trim_threshold;
+		}
+		return released;
+	}
+
+	//空闲字节数比上次 trim 之后增长 threshold 时自动 trim，默认不自动 trim
+	constexpr void set_trim_threshold(size_t threshold) noexcept {
+		trim_threshold = threshold;
+		next_trim = threshold == std::numeric_limits<size_t>::max() ? threshold : FreeBytes() + threshold;
+	}
+
+	//MEMORY_MANAGER_PROFILE 为 1 时平均每分配 bytes 字节抽样一次调用栈，默认 512 KiB，0 表示停止抽样
+	constexpr void set_sample_period(size_t bytes) noexcept {
+		profiler.set_sample_period(bytes);
+	}
+
+	//写出 pprof 可读取的堆快照：仍存活与累计抽中的块按调用栈汇总；未开启 MEMORY_MANAGER_PROFILE 或写入失败时返回 false
+	constexpr bool write_heap_profile(int fd) const noexcept {
+		return profiler.write_heap_profile(fd);
+	}
+
+	//largest_free_block 只扫描最大的非空分类，其余均为 O(1)
+	[[nodiscard]] constexpr MemoryPoolStats stats() const noexcept {
+		return {
+			chunk_count,
+			chunk_bytes,
+			large_count,
+			large_bytes,
+			large_cached_bytes,
+			free_block_list.size(),
+			free_block_list.free_bytes(),
+			cached_bytes,
+			free_block_list.largest(),
+			chunk_bytes - chunk_count * sizeof(Chunk) - FreeBytes() + large_bytes,
+			counters.snapshot()
+		};
 	}
 
 	template <typename U, typename... Args>
@@ -188,3 +1397,5 @@ public:
 		p->~U();
 	}
 };
+
+using MemoryPool = BasicMemoryPool<>;
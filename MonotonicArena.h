@@ -0,0 +1,169 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+#include "ChunkSource.h"
+
+
+//只能整体回退的单调分配器，每个 chunk 的大小从 MinChunkSize 开始按 2 倍增长，直至 MaxChunkSize
+template <size_t MinChunkSize = size_t{ 1 } << 12, size_t MaxChunkSize = size_t{ 1 } << 20, typename ChunkSource = NewChunkSource>
+class BasicMonotonicArena {
+	static_assert(std::has_single_bit(MinChunkSize) && std::has_single_bit(MaxChunkSize) && MinChunkSize <= MaxChunkSize);
+
+	static constexpr size_t alignment = alignof(std::max_align_t);
+
+	//buffer 紧跟在 Chunk 之后，chunk 按分配顺序串成链表，当前 chunk 之后的都是回退后留待复用的
+	struct alignas(alignment) Chunk {
+		Chunk* next;
+		size_t size; //包括 Chunk 本身
+
+		[[nodiscard]] constexpr std::byte* buffer() noexcept {
+			return reinterpret_cast<std::byte*>(this + 1);
+		}
+
+		[[nodiscard]] constexpr std::byte* end() noexcept {
+			return reinterpret_cast<std::byte*>(this) + size;
+		}
+	};
+
+	static_assert(MinChunkSize > sizeof(Chunk));
+
+	Chunk* chunk_head{};
+	Chunk* current{};
+	std::byte* cursor{};
+	std::byte* limit{};
+	size_t next_chunk_size{ MinChunkSize };
+	[[no_unique_address]] ChunkSource chunk_source{};
+
+public:
+	struct Checkpoint {
+		Chunk* chunk;
+		std::byte* cursor;
+	};
+
+	//离开作用域时回退到进入时的位置
+	class Scope {
+		BasicMonotonicArena& arena;
+		Checkpoint checkpoint;
+
+	public:
+		constexpr explicit Scope(BasicMonotonicArena& arena) noexcept: arena(arena), checkpoint(arena.checkpoint()) {}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		constexpr ~Scope() noexcept {
+			arena.rewind(checkpoint);
+		}
+	};
+
+	constexpr BasicMonotonicArena() noexcept = default;
+
+	constexpr explicit BasicMonotonicArena(ChunkSource chunk_source) noexcept: chunk_source(std::move(chunk_source)) {}
+
+	BasicMonotonicArena(const BasicMonotonicArena&) = delete;
+	BasicMonotonicArena& operator=(const BasicMonotonicArena&) = delete;
+
+	constexpr ~BasicMonotonicArena() noexcept {
+		while (chunk_head != nullptr) {
+			const auto chunk = std::exchange(chunk_head, chunk_head->next);
+			chunk_source.deallocate(chunk, chunk->size, alignof(Chunk));
+		}
+	}
+
+	//与 MemoryPool 相同，size 为 0 时总是返回 nullptr，不移动游标
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] constexpr void* allocate(size_t size, size_t align = alignment) {
+		if (size == 0) {
+			return nullptr;
+		}
+		const auto p = cursor + (-reinterpret_cast<std::uintptr_t>(cursor) & (align - 1));
+		if (p <= limit && size <= static_cast<size_t>(limit - p)) {
+			cursor = p + size;
+			return p;
+		}
+		return AllocateSlow(size, align);
+	}
+
+	[[nodiscard, gnu::alloc_size(2)]] constexpr void* allocate(size_t size, std::align_val_t align) {
+		return allocate(size, static_cast<size_t>(align));
+	}
+
+	//单个对象不回收
+	constexpr void deallocate(void*, size_t, size_t = alignment) noexcept {}
+
+	template <typename T>
+	[[nodiscard]] constexpr T* allocate() {
+		return static_cast<T*>(allocate(sizeof(T), alignof(T)));
+	}
+
+	template <typename T>
+	constexpr void deallocate(T*) noexcept {}
+
+	[[nodiscard]] constexpr Checkpoint checkpoint() const noexcept {
+		return { current, cursor };
+	}
+
+	//回退到 checkpoint，之后分配的内存全部作废，chunk 保留复用
+	constexpr void rewind(Checkpoint checkpoint) noexcept {
+		current = checkpoint.chunk;
+		cursor = checkpoint.cursor;
+		limit = current != nullptr ? current->end() : nullptr;
+	}
+
+	constexpr void reset() noexcept {
+		rewind({ nullptr, nullptr });
+	}
+
+	template <typename U, typename... Args>
+	constexpr void construct(U* p, Args&& ... args) {
+		std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	constexpr void destroy(U* p) noexcept {
+		p->~U();
+	}
+
+private:
+	//依次尝试回退后留下的 chunk，都放不下时在当前 chunk 之后插入一个新 chunk
+	//size 加上对齐与 Chunk 后须不超过 2^63，否则取整到 2 的幂时溢出，抛出 std::bad_alloc
+	[[nodiscard]] constexpr void* AllocateSlow(size_t size, size_t align) {
+		constexpr auto max_bytes = std::numeric_limits<size_t>::max() / 2 - sizeof(Chunk);
+		if (align > max_bytes || size > max_bytes - align) {
+			throw std::bad_alloc();
+		}
+		const auto bytes = size + std::max(align, alignment) - alignment;
+		auto next = current != nullptr ? current->next : chunk_head;
+		while (next != nullptr && bytes > static_cast<size_t>(next->end() - next->buffer())) {
+			next = next->next;
+		}
+		if (next == nullptr) {
+			next = NewChunk(bytes);
+		}
+
+		current = next;
+		limit = current->end();
+		cursor = current->buffer() + (-reinterpret_cast<std::uintptr_t>(current->buffer()) & (align - 1));
+		return std::exchange(cursor, cursor + size);
+	}
+
+	[[nodiscard]] constexpr Chunk* NewChunk(size_t bytes) {
+		const auto size = std::max(next_chunk_size, std::bit_ceil(bytes + sizeof(Chunk)));
+		next_chunk_size = std::min(next_chunk_size * 2, MaxChunkSize);
+
+		auto& link = current != nullptr ? current->next : chunk_head;
+		return link = new(chunk_source.allocate(size, alignof(Chunk))) Chunk{ link, size };
+	}
+};
+
+using MonotonicArena = BasicMonotonicArena<>;
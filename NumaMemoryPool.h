@@ -0,0 +1,141 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <sched.h>
+
+#include "MemoryPool.h"
+
+
+//每个 NUMA 节点一个 arena，分配时路由到当前线程所在节点，回收时由地址算出所属节点并归还给它
+template <size_t MaxNodes = 8, size_t MinChunkSize = size_t{ 1 } << 12, size_t MaxChunkSize = size_t{ 1 } << 20>
+class NumaMemoryPool {
+	static constexpr size_t slice_size = size_t{ 1 } << 36; //每个节点预留的虚拟地址空间
+
+	using Arena = BasicMemoryPool<MinChunkSize, MaxChunkSize, NumaChunkSource>;
+
+	struct alignas(64) Node {
+		std::mutex mutex;
+		std::optional<Arena> arena;
+	};
+
+	std::byte* base{};
+	Node nodes[MaxNodes];
+
+	NumaMemoryPool() {
+		const auto p = mmap(nullptr, slice_size * MaxNodes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (p == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+
+		base = static_cast<std::byte*>(p);
+		for (size_t node = 0; node != MaxNodes; ++node) {
+			nodes[node].arena.emplace(NumaChunkSource{ base + node * slice_size, slice_size, static_cast<int>(node) });
+		}
+	}
+
+public:
+	NumaMemoryPool(const NumaMemoryPool&) = delete;
+	NumaMemoryPool& operator=(const NumaMemoryPool&) = delete;
+
+	~NumaMemoryPool() noexcept {
+		for (auto& node : nodes) {
+			node.arena.reset();
+		}
+		munmap(base, slice_size * MaxNodes);
+	}
+
+	static NumaMemoryPool& instance() {
+		static NumaMemoryPool inst;
+		return inst;
+	}
+
+public:
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+		auto& node = nodes[current_node()];
+		std::lock_guard lock{ node.mutex };
+		return node.arena->allocate(size, align);
+	}
+
+	[[nodiscard, gnu::alloc_size(2)]] void* allocate(size_t size, std::align_val_t align) {
+		return allocate(size, static_cast<size_t>(align));
+	}
+
+	//在其他节点上回收时不加锁，压入所属 arena 的 RemoteFreeList，由该 arena 下次分配时取回
+	void deallocate(void* p) {
+		if (p == nullptr) {
+			return;
+		}
+
+		const auto index = node_of(p);
+		auto& node = nodes[index];
+		if (index != current_node()) {
+			node.arena->deallocate_remote(p);
+			return;
+		}
+		std::lock_guard lock{ node.mutex };
+		node.arena->deallocate(p);
+	}
+
+	//只有在同一节点上回收时才校验 size
+	void deallocate(void* p, size_t size, size_t align = alignof(std::max_align_t)) {
+		if (p == nullptr) {
+			return;
+		}
+
+		const auto index = node_of(p);
+		auto& node = nodes[index];
+		if (index != current_node()) {
+			node.arena->deallocate_remote(p);
+			return;
+		}
+		std::lock_guard lock{ node.mutex };
+		node.arena->deallocate(p, size, align);
+	}
+
+	void deallocate(void* p, size_t size, std::align_val_t align) {
+		deallocate(p, size, static_cast<size_t>(align));
+	}
+
+	template <typename T>
+	[[nodiscard]] T* allocate() {
+		return static_cast<T*>(allocate(sizeof(T), alignof(T)));
+	}
+
+	template <typename T>
+	void deallocate(T* p) {
+		deallocate(p, sizeof(T), alignof(T));
+	}
+
+	size_t trim() {
+		size_t released = 0;
+		for (auto& node : nodes) {
+			std::lock_guard lock{ node.mutex };
+			released += node.arena->trim();
+		}
+		return released;
+	}
+
+	[[nodiscard]] MemoryPoolStats stats(size_t node) {
+		std::lock_guard lock{ nodes[node].mutex };
+		return nodes[node].arena->stats();
+	}
+
+	//p 须由本内存池分配
+	[[nodiscard]] size_t node_of(const void* p) const noexcept {
+		return static_cast<size_t>(static_cast<const std::byte*>(p) - base) / slice_size;
+	}
+
+	//节点数超过 MaxNodes 时取模
+	[[nodiscard]] static size_t current_node() noexcept {
+		unsigned cpu, node;
+		if (getcpu(&cpu, &node) != 0) {
+			return 0;
+		}
+		return node % MaxNodes;
+	}
+};
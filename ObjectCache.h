@@ -0,0 +1,148 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <limits>
+
+#include "Allocator.h"
+
+
+//默认的 reset：归还时不做任何事
+struct NoReset {
+	template <typename T>
+	constexpr void operator()(T&) const noexcept {}
+};
+
+
+//在 Allocator 之上缓存已构造的对象：release 时只调用 reset 而不析构，下次 acquire 直接取出，省去构造与析构
+//对象在缓存中时，其后额外的 next 指针将它们串成链表，对象本身的字节保持不变
+template <typename T, typename Reset = NoReset, size_t MinBlocksPerChunk = size_t{ 1 } << 6, size_t MaxBlocksPerChunk = size_t{ 1 } << 16, typename ChunkSource = NewChunkSource>
+class ObjectCache {
+	struct Slot {
+		alignas(T) std::byte buffer[sizeof(T)];
+		Slot* next;
+
+		[[nodiscard]] T* object() noexcept {
+			return reinterpret_cast<T*>(buffer);
+		}
+	};
+
+	Allocator<Slot, MinBlocksPerChunk, MaxBlocksPerChunk, ChunkSource> allocator;
+	Slot* head{};
+	size_t count{};
+	size_t capacity{ std::numeric_limits<size_t>::max() };
+	[[no_unique_address]] Reset reset{};
+
+public:
+	//交给 std::unique_ptr 的删除器，离开作用域时 release
+	struct Releaser {
+		ObjectCache* cache;
+
+		void operator()(T* p) const {
+			cache->release(p);
+		}
+	};
+
+	using Handle = std::unique_ptr<T, Releaser>;
+
+	ObjectCache() = default;
+
+	explicit ObjectCache(Reset reset, const ChunkSource& chunk_source = {}): allocator(chunk_source), reset(std::move(reset)) {}
+
+	ObjectCache(const ObjectCache&) = delete;
+	ObjectCache& operator=(const ObjectCache&) = delete;
+
+	//析构缓存中的对象；仍在使用中的对象只随 chunk 释放内存，不调用析构函数
+	~ObjectCache() noexcept {
+		Clear();
+	}
+
+	//有缓存的对象时直接返回，args 被忽略；否则分配并以 args 构造
+	template <typename... Args>
+	[[nodiscard]] T* acquire(Args&& ... args) {
+		if (head != nullptr) {
+			--count;
+			return std::exchange(head, head->next)->object();
+		}
+
+		const auto slot = allocator.allocate();
+		try {
+			return std::construct_at(slot->object(), std::forward<Args>(args)...);
+		} catch (...) {
+			allocator.deallocate(slot);
+			throw;
+		}
+	}
+
+	template <typename... Args>
+	[[nodiscard]] Handle make(Args&& ... args) {
+		return Handle{ acquire(std::forward<Args>(args)...), Releaser{ this } };
+	}
+
+	//调用 reset 后放回缓存；缓存已满或 reset 抛出异常时析构并回收
+	void release(T* p) {
+		if (p == nullptr) {
+			return;
+		}
+
+		const auto slot = reinterpret_cast<Slot*>(p);
+		if (count == capacity) {
+			Destroy(slot);
+			return;
+		}
+		try {
+			reset(*p);
+		} catch (...) {
+			Destroy(slot);
+			throw;
+		}
+		slot->next = head;
+		head = slot;
+		++count;
+	}
+
+	//析构并回收，不放回缓存，用于已损坏的对象
+	void discard(T* p) {
+		if (p != nullptr) {
+			Destroy(reinterpret_cast<Slot*>(p));
+		}
+	}
+
+	//析构所有缓存的对象，再 trim 底层的 Allocator，返回归还的字节数
+	size_t trim() {
+		Clear();
+		return allocator.trim();
+	}
+
+	//缓存的对象数超过 n 时，多余的在 release 时直接析构；默认不限
+	void set_capacity(size_t n) {
+		capacity = n;
+		while (count > capacity) {
+			--count;
+			Destroy(std::exchange(head, head->next));
+		}
+	}
+
+	[[nodiscard]] size_t cached_count() const noexcept {
+		return count;
+	}
+
+private:
+	void Destroy(Slot* slot) {
+		std::destroy_at(slot->object());
+		allocator.deallocate(slot);
+	}
+
+	void Clear() noexcept {
+		while (head != nullptr) {
+			const auto slot = std::exchange(head, head->next);
+			std::destroy_at(slot->object());
+			allocator.deallocate(slot);
+		}
+		count = 0;
+	}
+};
@@ -0,0 +1,153 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include "ChunkSource.h"
+
+
+//以 page_size 为粒度将地址映射到一个整数的三层基数树，覆盖 48 位地址空间，节点在首次写入时从 ChunkSource 分配
+template <typename ChunkSource = NewChunkSource>
+class PageMap {
+public:
+	static constexpr size_t page_shift = 12;
+	static constexpr size_t page_size = size_t{ 1 } << page_shift;
+
+private:
+	static constexpr size_t address_bits = 48;
+	static constexpr size_t level_bits = (address_bits - page_shift) / 3;
+	static constexpr size_t level_size = size_t{ 1 } << level_bits;
+
+	static_assert(page_shift + level_bits * 3 == address_bits);
+
+	struct Leaf {
+		std::uintptr_t values[level_size];
+	};
+
+	struct Interior {
+		Leaf* leaves[level_size];
+	};
+
+	struct Root {
+		Interior* interiors[level_size];
+	};
+
+	Root* root{};
+	[[no_unique_address]] ChunkSource chunk_source{};
+
+public:
+	constexpr PageMap() noexcept = default;
+
+	constexpr explicit PageMap(ChunkSource chunk_source) noexcept: chunk_source(std::move(chunk_source)) {}
+
+	PageMap(const PageMap&) = delete;
+	PageMap& operator=(const PageMap&) = delete;
+
+	constexpr ~PageMap() noexcept {
+		if (root == nullptr) {
+			return;
+		}
+		for (const auto interior : root->interiors) {
+			if (interior != nullptr) {
+				for (const auto leaf : interior->leaves) {
+					if (leaf != nullptr) {
+						Delete(leaf);
+					}
+				}
+				Delete(interior);
+			}
+		}
+		Delete(root);
+	}
+
+	//未写入过的页返回 0
+	[[nodiscard]] constexpr std::uintptr_t get(const void* p) const noexcept {
+		const auto page = reinterpret_cast<std::uintptr_t>(p) >> page_shift;
+		if (root == nullptr) {
+			return 0;
+		}
+		const auto interior = root->interiors[page >> (level_bits * 2)];
+		if (interior == nullptr) {
+			return 0;
+		}
+		const auto leaf = interior->leaves[(page >> level_bits) & (level_size - 1)];
+		return leaf != nullptr ? leaf->values[page & (level_size - 1)] : 0;
+	}
+
+	//将 [p, p + size) 覆盖的所有页设为 value，分配节点失败时抛出 std::bad_alloc
+	constexpr void set(const void* p, size_t size, std::uintptr_t value) {
+		if (!try_set(p, size, value)) {
+			throw std::bad_alloc();
+		}
+	}
+
+	//分配节点失败时返回 false，之前的页已经写入；写入过的页不再分配节点，不会失败
+	[[nodiscard]] constexpr bool try_set(const void* p, size_t size, std::uintptr_t value) noexcept {
+		const auto first = reinterpret_cast<std::uintptr_t>(p) >> page_shift;
+		const auto last = (reinterpret_cast<std::uintptr_t>(p) + size - 1) >> page_shift;
+		for (auto page = first; page <= last; ++page) {
+			const auto slot = Slot(page);
+			if (slot == nullptr) {
+				return false;
+			}
+			*slot = value;
+		}
+		return true;
+	}
+
+	//按地址顺序对每个值非 0 的页调用 f(page, value)，只访问已分配的节点
+	template <typename F>
+	constexpr void for_each(F&& f) const {
+		if (root == nullptr) {
+			return;
+		}
+		for (size_t i = 0; i != level_size; ++i) {
+			if (const auto interior = root->interiors[i]; interior != nullptr) {
+				for (size_t j = 0; j != level_size; ++j) {
+					if (const auto leaf = interior->leaves[j]; leaf != nullptr) {
+						for (size_t k = 0; k != level_size; ++k) {
+							if (const auto value = leaf->values[k]; value != 0) {
+								f(reinterpret_cast<void*>(((i << level_bits | j) << level_bits | k) << page_shift), value);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+private:
+	template <typename Node>
+	[[nodiscard]] constexpr Node* New() noexcept {
+		const auto p = TryAllocateChunk(chunk_source, sizeof(Node), alignof(Node));
+		return p != nullptr ? new(p) Node{} : nullptr;
+	}
+
+	template <typename Node>
+	constexpr void Delete(Node* node) noexcept {
+		chunk_source.deallocate(node, sizeof(Node), alignof(Node));
+	}
+
+	//分配节点失败时返回 nullptr
+	[[nodiscard]] constexpr std::uintptr_t* Slot(std::uintptr_t page) noexcept {
+		if (root == nullptr && (root = New<Root>()) == nullptr) {
+			return nullptr;
+		}
+		auto& interior = root->interiors[page >> (level_bits * 2)];
+		if (interior == nullptr && (interior = New<Interior>()) == nullptr) {
+			return nullptr;
+		}
+		auto& leaf = interior->leaves[(page >> level_bits) & (level_size - 1)];
+		if (leaf == nullptr && (leaf = New<Leaf>()) == nullptr) {
+			return nullptr;
+		}
+		return &leaf->values[page & (level_size - 1)];
+	}
+};
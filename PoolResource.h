@@ -0,0 +1,148 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <memory_resource>
+#include <limits>
+#include <new>
+
+#include "Allocator.h"
+#include "MemoryPool.h"
+#include "ThreadCache.h"
+
+
+//将 MemoryPool、NumaMemoryPool、MonotonicArena 等提供 allocate(size, align)/deallocate(p, size, align) 的内存池适配为 memory_resource
+template <typename Pool = MemoryPool>
+class PoolResource : public std::pmr::memory_resource {
+	Pool* pool;
+
+public:
+	PoolResource() noexcept: pool(&Pool::instance()) {}
+
+	explicit PoolResource(Pool& pool) noexcept: pool(&pool) {}
+
+	[[nodiscard]] Pool& upstream() const noexcept {
+		return *pool;
+	}
+
+private:
+	//内存池对 0 字节返回 nullptr，而 memory_resource 须返回有效指针
+	void* do_allocate(size_t bytes, size_t align) override {
+		return pool->allocate(std::max(bytes, size_t{ 1 }), align);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t align) override {
+		pool->deallocate(p, std::max(bytes, size_t{ 1 }), align);
+	}
+
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		const auto resource = dynamic_cast<const PoolResource*>(&other);
+		return resource != nullptr && resource->pool == pool;
+	}
+};
+
+
+//每次调用都转发给当前线程的 ThreadCache，因此可以在一个线程分配、另一个线程回收
+class ThreadCacheResource : public std::pmr::memory_resource {
+	void* do_allocate(size_t bytes, size_t align) override {
+		return ThreadCache::local().allocate(std::max(bytes, size_t{ 1 }), align);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t align) override {
+		ThreadCache::local().deallocate(p, std::max(bytes, size_t{ 1 }), align);
+	}
+
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return dynamic_cast<const ThreadCacheResource*>(&other) != nullptr;
+	}
+};
+
+
+//不超过 sizeof(T)、对齐不超过 alignof(T) 的请求由自带的 Allocator<T> 分配，其余交给 upstream
+template <typename T>
+class AllocatorResource : public std::pmr::memory_resource {
+	Allocator<T> allocator{};
+	std::pmr::memory_resource* upstream_resource;
+
+public:
+	explicit AllocatorResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept: upstream_resource(upstream) {}
+
+	[[nodiscard]] std::pmr::memory_resource* upstream() const noexcept {
+		return upstream_resource;
+	}
+
+private:
+	[[nodiscard]] static constexpr bool Fits(size_t bytes, size_t align) noexcept {
+		return bytes <= sizeof(T) && align <= alignof(T);
+	}
+
+	void* do_allocate(size_t bytes, size_t align) override {
+		return Fits(bytes, align) ? allocator.allocate() : upstream_resource->allocate(bytes, align);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t align) override {
+		if (Fits(bytes, align)) {
+			allocator.deallocate(static_cast<T*>(p));
+		} else {
+			upstream_resource->deallocate(p, bytes, align);
+		}
+	}
+
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+
+//满足 Allocator 要求的标准分配器，从 Pool 分配 n 个 T
+template <typename T, typename Pool = MemoryPool>
+class PoolAllocator {
+	template <typename, typename>
+	friend class PoolAllocator;
+
+	Pool* pool;
+
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	template <typename U>
+	struct rebind {
+		using other = PoolAllocator<U, Pool>;
+	};
+
+	PoolAllocator() noexcept: pool(&Pool::instance()) {}
+
+	explicit PoolAllocator(Pool& pool) noexcept: pool(&pool) {}
+
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U, Pool>& other) noexcept: pool(other.pool) {}
+
+	[[nodiscard]] T* allocate(size_t n) {
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+			throw std::bad_array_new_length();
+		}
+		const auto p = pool->allocate(std::max(n * sizeof(T), size_t{ 1 }), alignof(T));
+		if (p == nullptr) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, size_t n) {
+		pool->deallocate(p, std::max(n * sizeof(T), size_t{ 1 }), alignof(T));
+	}
+
+	[[nodiscard]] Pool& upstream() const noexcept {
+		return *pool;
+	}
+
+	template <typename U>
+	[[nodiscard]] bool operator==(const PoolAllocator<U, Pool>& other) const noexcept {
+		return pool == other.pool;
+	}
+};
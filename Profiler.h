@@ -0,0 +1,352 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <execinfo.h>
+
+#include "ChunkSource.h"
+
+
+//为 1 时 Allocator 与 MemoryPool 按分配的字节数抽样记录调用栈，可导出 pprof 的堆快照；默认关闭，关闭时 HeapProfiler 为空类
+#ifndef MEMORY_MANAGER_PROFILE
+#define MEMORY_MANAGER_PROFILE 0
+#endif
+
+
+//与 tcmalloc 相同的抽样：相邻两次抽样之间分配的字节数服从均值为 sample_period 的指数分布，
+//因此大小为 size 的分配被抽中的概率为 1 - exp(-size / sample_period)，pprof 按 heap_v2 的格式据此还原总量
+//抽中的块与去重后的调用栈存放在两张开放寻址的哈希表中，表从 MetadataSource 分配，不经过全局 operator new；与所属的内存池一样不是线程安全的
+template <typename MetadataSource = NewChunkSource, bool Enabled = MEMORY_MANAGER_PROFILE>
+class HeapProfiler {
+	static constexpr size_t max_depth = 32;
+	static constexpr size_t skip_frames = 1; //Record 本身，它不被内联，因此不会多跳过调用者
+	static constexpr size_t min_capacity = 64;
+	static constexpr size_t no_stack = std::numeric_limits<size_t>::max(); //FindStack 无法扩容
+
+	struct Stack {
+		uint64_t hash;
+		size_t depth;
+		void* frames[max_depth];
+		size_t live_count;
+		size_t live_bytes;
+		size_t alloc_count; //累计抽中的次数，包括已回收的
+		size_t alloc_bytes;
+	};
+
+	//p 为 nullptr 表示空槽
+	struct SampledBlock {
+		void* p;
+		size_t size;
+		size_t stack;
+	};
+
+	Stack* stacks{}; //按首次出现的顺序追加，下标不变
+	size_t stack_count{};
+	size_t stack_capacity{};
+	size_t* stack_slots{}; //stacks 的下标加 1，0 表示空槽
+	size_t stack_slot_count{};
+	SampledBlock* samples{};
+	size_t sample_count{};
+	size_t sample_slot_count{};
+	size_t sample_period{ size_t{ 1 } << 19 };
+	std::ptrdiff_t bytes_until_sample{ static_cast<std::ptrdiff_t>(sample_period) }; //第一次抽样之前固定为 sample_period，之后为随机的间隔
+	uint64_t rng_state{ 0x9e3779b97f4a7c15 };
+	[[no_unique_address]] MetadataSource metadata_source{};
+
+public:
+	constexpr HeapProfiler() noexcept = default;
+
+	HeapProfiler(const HeapProfiler&) = delete;
+	HeapProfiler& operator=(const HeapProfiler&) = delete;
+
+	~HeapProfiler() noexcept {
+		Free(stacks, stack_capacity);
+		Free(stack_slots, stack_slot_count);
+		Free(samples, sample_slot_count);
+	}
+
+	//快速路径只有一次减法和一次比较
+	void on_allocate(void* p, size_t size) noexcept {
+		if ((bytes_until_sample -= static_cast<std::ptrdiff_t>(size)) > 0) {
+			return;
+		}
+		Record(p, size);
+	}
+
+	//还没有抽中的块时不查表
+	void on_deallocate(void* p) noexcept {
+		if (sample_count != 0) {
+			Erase(p);
+		}
+	}
+
+	//平均每分配 bytes 字节抽样一次，0 表示停止抽样；已记录的样本保留
+	void set_sample_period(size_t bytes) noexcept {
+		sample_period = bytes;
+		bytes_until_sample = NextInterval();
+	}
+
+	[[nodiscard]] size_t get_sample_period() const noexcept {
+		return sample_period;
+	}
+
+	//以 pprof 的旧版文本格式（heap_v2）写出仍存活的样本与累计的样本，之后附上 /proc/self/maps 以便符号化；写入失败时返回 false
+	bool write_heap_profile(int fd) const noexcept {
+		size_t live_count = 0, live_bytes = 0, alloc_count = 0, alloc_bytes = 0;
+		for (auto it = stacks; it != stacks + stack_count; ++it) {
+			live_count += it->live_count;
+			live_bytes += it->live_bytes;
+			alloc_count += it->alloc_count;
+			alloc_bytes += it->alloc_bytes;
+		}
+
+		char line[128 + max_depth * 20];
+		auto n = std::snprintf(line, sizeof(line), "heap profile: %zu: %zu [ %zu: %zu] @ heap_v2/%zu\n", live_count, live_bytes, alloc_count, alloc_bytes, sample_period);
+		if (!WriteAll(fd, line, static_cast<size_t>(n))) {
+			return false;
+		}
+		for (auto it = stacks; it != stacks + stack_count; ++it) {
+			n = std::snprintf(line, sizeof(line), "%zu: %zu [ %zu: %zu] @", it->live_count, it->live_bytes, it->alloc_count, it->alloc_bytes);
+			for (size_t i = 0; i != it->depth; ++i) {
+				n += std::snprintf(line + n, sizeof(line) - static_cast<size_t>(n), " %p", it->frames[i]);
+			}
+			line[n++] = '\n';
+			if (!WriteAll(fd, line, static_cast<size_t>(n))) {
+				return false;
+			}
+		}
+
+		constexpr char maps_header[] = "\nMAPPED_LIBRARIES:\n";
+		if (!WriteAll(fd, maps_header, sizeof(maps_header) - 1)) {
+			return false;
+		}
+		const auto maps = ::open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+		if (maps < 0) {
+			return false;
+		}
+		char buffer[4096];
+		auto ok = true;
+		for (ssize_t count; ok && (count = ::read(maps, buffer, sizeof(buffer))) > 0;) {
+			ok = WriteAll(fd, buffer, static_cast<size_t>(count));
+		}
+		::close(maps);
+		return ok;
+	}
+
+private:
+	//xorshift64*，取高 53 位作为 (0, 1] 中的均匀分布
+	[[nodiscard]] std::ptrdiff_t NextInterval() noexcept {
+		if (sample_period == 0) {
+			return std::numeric_limits<std::ptrdiff_t>::max();
+		}
+		rng_state ^= rng_state >> 12;
+		rng_state ^= rng_state << 25;
+		rng_state ^= rng_state >> 27;
+		const auto u = static_cast<double>(((rng_state * 0x2545f4914f6cdd1d) >> 11) + 1) / static_cast<double>(uint64_t{ 1 } << 53);
+		const auto interval = -std::log(u) * static_cast<double>(sample_period);
+		return static_cast<std::ptrdiff_t>(std::min(interval, static_cast<double>(std::numeric_limits<std::ptrdiff_t>::max() / 2))) + 1;
+	}
+
+	[[nodiscard]] static constexpr size_t HashPointer(const void* p) noexcept {
+		return static_cast<size_t>((reinterpret_cast<std::uintptr_t>(p) >> 4) * 0x9e3779b97f4a7c15);
+	}
+
+	[[nodiscard]] static constexpr uint64_t HashStack(void* const* frames, size_t depth) noexcept {
+		uint64_t hash = 0xcbf29ce484222325;
+		for (size_t i = 0; i != depth; ++i) {
+			hash = (hash ^ reinterpret_cast<std::uintptr_t>(frames[i])) * 0x100000001b3;
+		}
+		return hash;
+	}
+
+	//失败时返回 nullptr；不抛出异常，以免在 malloc 的锁内构造异常对象
+	template <typename T>
+	[[nodiscard]] T* Allocate(size_t count) noexcept {
+		const auto ret = static_cast<T*>(TryAllocateChunk(metadata_source, count * sizeof(T), alignof(T)));
+		if (ret != nullptr) {
+			std::fill_n(ret, count, T{});
+		}
+		return ret;
+	}
+
+	template <typename T>
+	void Free(T* p, size_t count) noexcept {
+		if (p != nullptr) {
+			metadata_source.deallocate(p, count * sizeof(T), alignof(T));
+		}
+	}
+
+	//表满或无法扩容时丢弃这个样本，不影响分配本身
+	[[gnu::noinline]] void Record(void* p, size_t size) noexcept {
+		bytes_until_sample = NextInterval();
+
+		void* frames[max_depth + skip_frames];
+		const auto total = static_cast<size_t>(::backtrace(frames, static_cast<int>(max_depth + skip_frames)));
+		const auto first = std::min(total, skip_frames);
+		if (!ReserveSamples()) {
+			return;
+		}
+		const auto index = FindStack(frames + first, total - first);
+		if (index == no_stack) {
+			return;
+		}
+		auto& stack = stacks[index];
+		++stack.live_count;
+		stack.live_bytes += size;
+		++stack.alloc_count;
+		stack.alloc_bytes += size;
+		Insert({ p, size, index });
+	}
+
+	//返回调用栈在 stacks 中的下标，不存在时追加；无法扩容时返回 no_stack
+	[[nodiscard]] size_t FindStack(void* const* frames, size_t depth) noexcept {
+		if ((stack_count + 1) * 2 > stack_slot_count && !RehashStacks(std::max(min_capacity, stack_slot_count * 2))) {
+			return no_stack;
+		}
+		const auto hash = HashStack(frames, depth);
+		const auto mask = stack_slot_count - 1;
+		auto slot = static_cast<size_t>(hash) & mask;
+		for (; stack_slots[slot] != 0; slot = (slot + 1) & mask) {
+			const auto& stack = stacks[stack_slots[slot] - 1];
+			if (stack.hash == hash && stack.depth == depth && std::equal(frames, frames + depth, stack.frames)) {
+				return stack_slots[slot] - 1;
+			}
+		}
+
+		if (stack_count == stack_capacity) {
+			const auto capacity = std::max(min_capacity, stack_capacity * 2);
+			const auto grown = Allocate<Stack>(capacity);
+			if (grown == nullptr) {
+				return no_stack;
+			}
+			std::copy_n(stacks, stack_count, grown);
+			Free(stacks, stack_capacity);
+			stacks = grown;
+			stack_capacity = capacity;
+		}
+		auto& stack = stacks[stack_count];
+		stack.hash = hash;
+		stack.depth = depth;
+		std::copy_n(frames, depth, stack.frames);
+		stack_slots[slot] = ++stack_count;
+		return stack_count - 1;
+	}
+
+	[[nodiscard]] bool RehashStacks(size_t slot_count) noexcept {
+		const auto slots = Allocate<size_t>(slot_count);
+		if (slots == nullptr) {
+			return false;
+		}
+		for (size_t i = 0; i != stack_count; ++i) {
+			auto slot = static_cast<size_t>(stacks[i].hash) & (slot_count - 1);
+			while (slots[slot] != 0) {
+				slot = (slot + 1) & (slot_count - 1);
+			}
+			slots[slot] = i + 1;
+		}
+		Free(stack_slots, stack_slot_count);
+		stack_slots = slots;
+		stack_slot_count = slot_count;
+		return true;
+	}
+
+	//装载因子不超过 1/2，无法扩容时返回 false
+	[[nodiscard]] bool ReserveSamples() noexcept {
+		if ((sample_count + 1) * 2 <= sample_slot_count) {
+			return true;
+		}
+		const auto slot_count = std::max(min_capacity, sample_slot_count * 2);
+		const auto grown = Allocate<SampledBlock>(slot_count);
+		if (grown == nullptr) {
+			return false;
+		}
+		const auto old = std::exchange(samples, grown);
+		const auto old_count = std::exchange(sample_slot_count, slot_count);
+		sample_count = 0;
+		for (auto it = old; it != old + old_count; ++it) {
+			if (it->p != nullptr) {
+				Insert(*it);
+			}
+		}
+		Free(old, old_count);
+		return true;
+	}
+
+	//同一地址的旧样本只会在回收时删除，这里无需查重
+	void Insert(const SampledBlock& sample) noexcept {
+		const auto mask = sample_slot_count - 1;
+		auto slot = HashPointer(sample.p) & mask;
+		while (samples[slot].p != nullptr) {
+			slot = (slot + 1) & mask;
+		}
+		samples[slot] = sample;
+		++sample_count;
+	}
+
+	//线性探测的删除：把之后同一探测链上的样本依次前移，不留墓碑
+	void Erase(void* p) noexcept {
+		const auto mask = sample_slot_count - 1;
+		auto slot = HashPointer(p) & mask;
+		for (; samples[slot].p != p; slot = (slot + 1) & mask) {
+			if (samples[slot].p == nullptr) {
+				return;
+			}
+		}
+
+		auto& stack = stacks[samples[slot].stack];
+		--stack.live_count;
+		stack.live_bytes -= samples[slot].size;
+		--sample_count;
+		for (auto next = (slot + 1) & mask; samples[next].p != nullptr; next = (next + 1) & mask) {
+			const auto home = HashPointer(samples[next].p) & mask;
+			//home 不在 (slot, next] 之中时，next 可以移到 slot
+			if (((next - home) & mask) >= ((next - slot) & mask)) {
+				samples[slot] = samples[next];
+				slot = next;
+			}
+		}
+		samples[slot].p = nullptr;
+	}
+
+	[[nodiscard]] static bool WriteAll(int fd, const char* data, size_t size) noexcept {
+		while (size != 0) {
+			const auto n = ::write(fd, data, size);
+			if (n < 0) {
+				return false;
+			}
+			data += n;
+			size -= static_cast<size_t>(n);
+		}
+		return true;
+	}
+};
+
+template <typename MetadataSource>
+class HeapProfiler<MetadataSource, false> {
+public:
+	constexpr void on_allocate(void*, size_t) noexcept {}
+
+	constexpr void on_deallocate(void*) noexcept {}
+
+	constexpr void set_sample_period(size_t) noexcept {}
+
+	[[nodiscard]] constexpr size_t get_sample_period() const noexcept {
+		return 0;
+	}
+
+	//未开启 MEMORY_MANAGER_PROFILE 时没有样本可写
+	constexpr bool write_heap_profile(int) const noexcept {
+		return false;
+	}
+};
@@ -0,0 +1,177 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <new>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+#include "MemoryPool.h"
+#include "Tlsf.h"
+
+
+//在一段固定的预留内存上实现经典 TLSF，allocate 与 deallocate 最坏情况都是 O(1)，从不向系统申请内存
+//块布局与切分、合并见 TlsfHeap，块头中直接存放指针
+template <typename ChunkSource = NewChunkSource>
+class BasicRealTimePool {
+	using Heap = TlsfHeap<PointerAddressing>;
+
+	static constexpr size_t alignment = Heap::alignment;
+	static constexpr size_t touch_size = size_t{ 1 } << 12; //构造时按此步长写入，预先建立页表
+
+	std::byte* buffer{};
+	size_t capacity{};
+	bool owned{};
+	Heap::State state{};
+	[[no_unique_address]] ChunkSource chunk_source{};
+	[[no_unique_address]] PoolCounters counters{};
+
+public:
+	//从 ChunkSource 一次性预留 bytes 字节并逐页写入，之后不再申请内存
+	explicit BasicRealTimePool(size_t bytes, ChunkSource chunk_source = {}): chunk_source(std::move(chunk_source)) {
+		bytes = (bytes + alignment - 1) & ~(alignment - 1);
+		const auto p = static_cast<std::byte*>(this->chunk_source.allocate(bytes, alignment));
+		for (size_t offset = 0; offset < bytes; offset += touch_size) {
+			p[offset] = std::byte{};
+		}
+		Init(p, bytes);
+		owned = true;
+	}
+
+	//使用调用者提供的内存，不取得所有权
+	explicit BasicRealTimePool(std::span<std::byte> memory) noexcept {
+		const auto begin = reinterpret_cast<std::byte*>((reinterpret_cast<std::uintptr_t>(memory.data()) + alignment - 1) & ~(alignment - 1));
+		const auto end = reinterpret_cast<std::byte*>(reinterpret_cast<std::uintptr_t>(memory.data() + memory.size()) & ~(alignment - 1));
+		Init(begin, begin < end ? static_cast<size_t>(end - begin) : 0);
+	}
+
+	BasicRealTimePool(const BasicRealTimePool&) = delete;
+	BasicRealTimePool& operator=(const BasicRealTimePool&) = delete;
+
+	~BasicRealTimePool() noexcept {
+		if (owned) {
+			chunk_source.deallocate(buffer, capacity, alignment);
+		}
+	}
+
+private:
+	[[nodiscard]] Heap heap() noexcept {
+		return { state, {} };
+	}
+
+	void Init(std::byte* p, size_t bytes) noexcept {
+		buffer = p;
+		capacity = bytes;
+		if (bytes >= Heap::min_block_size + Heap::header_size) {
+			heap().format(p, bytes);
+		}
+	}
+
+public:
+	//空间不足时返回 nullptr；align 须为 2 的幂
+	[[nodiscard]] void* try_allocate(size_t size, size_t align = alignment) noexcept {
+		if (size == 0 || size > capacity) {
+			return nullptr;
+		}
+		const auto ret = heap().allocate(size, align);
+		if (ret == nullptr) {
+			return nullptr;
+		}
+		counters.add(PoolEvent::allocate);
+		counters.record(std::bit_width(size - 1));
+		return ret;
+	}
+
+	//空间不足时抛出 std::bad_alloc
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] void* allocate(size_t size, size_t align = alignment) {
+		if (size == 0) {
+			return nullptr;
+		}
+		if (const auto ret = try_allocate(size, align); ret != nullptr) {
+			return ret;
+		}
+		throw std::bad_alloc();
+	}
+
+	[[nodiscard, gnu::alloc_size(2)]] void* allocate(size_t size, std::align_val_t align) {
+		return allocate(size, static_cast<size_t>(align));
+	}
+
+	//与物理上相邻的空闲块立即合并
+	void deallocate(void* p) noexcept {
+		if (p == nullptr) {
+			return;
+		}
+
+		counters.add(PoolEvent::deallocate);
+		counters.add(PoolEvent::merge, heap().deallocate(p));
+	}
+
+	//size 和 align 为分配时的参数，MEMORY_POOL_CHECK_SIZE 为 1 时校验
+	void deallocate(void* p, [[maybe_unused]] size_t size, [[maybe_unused]] size_t align = alignment) {
+		if (p == nullptr || size == 0) {
+			return;
+		}
+#if MEMORY_POOL_CHECK_SIZE
+		if (!Heap::matches(p, size, align)) {
+			throw std::runtime_error("The size does not match the allocation.");
+		}
+#endif
+		deallocate(p);
+	}
+
+	void deallocate(void* p, size_t size, std::align_val_t align) {
+		deallocate(p, size, static_cast<size_t>(align));
+	}
+
+	[[nodiscard]] size_t usable_size(void* p) const noexcept {
+		return Heap::usable_size(p);
+	}
+
+	template <typename T>
+	[[nodiscard]] T* allocate() {
+		return static_cast<T*>(allocate(sizeof(T), alignof(T)));
+	}
+
+	template <typename T>
+	void deallocate(T* p) {
+		deallocate(p, sizeof(T), alignof(T));
+	}
+
+	//预留内存整体作为一个 chunk；largest_free_block 只扫描最大的非空分类
+	[[nodiscard]] MemoryPoolStats stats() const noexcept {
+		return {
+			1,
+			capacity,
+			0,
+			0,
+			0,
+			state.free_count,
+			state.free_bytes,
+			0,
+			Heap::largest(state, {}),
+			capacity - state.free_bytes,
+			counters.snapshot()
+		};
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&& ... args) {
+		std::uninitialized_construct_using_allocator(p, *this, std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) noexcept {
+		p->~U();
+	}
+};
+
+using RealTimePool = BasicRealTimePool<>;
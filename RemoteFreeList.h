@@ -0,0 +1,66 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <atomic>
+#include <cstddef>
+#include <span>
+
+
+//其他线程回收的块：任意线程以 CAS 压入，所有者一次取走整条链表，因此没有 ABA 问题
+//块的第一个字存放 next，压入时只写块本身与链表头，所有者的元数据不在线程间移动
+class RemoteFreeList {
+	struct Node {
+		Node* next;
+	};
+
+	std::atomic<Node*> head{};
+
+public:
+	constexpr RemoteFreeList() noexcept = default;
+
+	RemoteFreeList(const RemoteFreeList&) = delete;
+	RemoteFreeList& operator=(const RemoteFreeList&) = delete;
+
+	void push(void* p) noexcept {
+		const auto node = static_cast<Node*>(p);
+		Splice(node, node);
+	}
+
+	//先将这些块串成一段，再以一次 CAS 整段压入
+	void push(std::span<void* const> ps) noexcept {
+		if (ps.empty()) {
+			return;
+		}
+		for (auto it = ps.begin(); it != ps.end() - 1; ++it) {
+			static_cast<Node*>(*it)->next = static_cast<Node*>(*(it + 1));
+		}
+		Splice(static_cast<Node*>(ps.front()), static_cast<Node*>(ps.back()));
+	}
+
+	//只读一次链表头，用于在快速路径上判断是否需要 drain
+	[[nodiscard]] bool empty() const noexcept {
+		return head.load(std::memory_order_relaxed) == nullptr;
+	}
+
+	//取走整条链表，依次对每个块调用 f，返回块数
+	template <typename F>
+	size_t drain(F&& f) {
+		size_t count = 0;
+		for (auto it = head.exchange(nullptr, std::memory_order_acquire); it != nullptr; ++count) {
+			f(static_cast<void*>(std::exchange(it, it->next)));
+		}
+		return count;
+	}
+
+private:
+	void Splice(Node* first, Node* last) noexcept {
+		auto old = head.load(std::memory_order_relaxed);
+		do {
+			last->next = old;
+		} while (!head.compare_exchange_weak(old, first, std::memory_order_release, std::memory_order_relaxed));
+	}
+};
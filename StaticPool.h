@@ -0,0 +1,134 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <tuple>
+#include <array>
+#include <cstddef>
+
+#include "Allocator.h"
+
+
+//编译期确定 size class 的内存池：每个 size 对应一个 Allocator，allocate<T>() 在编译期选出 sizeof 与 alignof 都容纳 T 的最小 size class，运行时没有任何查找
+//Sizes 须严格递增；每个 size class 的对齐为整除 size 的最大 2 的幂，但不超过 alignof(std::max_align_t)
+template <typename ChunkSource, size_t... Sizes>
+class BasicStaticPool {
+	static_assert(sizeof...(Sizes) != 0);
+
+	static constexpr std::array<size_t, sizeof...(Sizes)> sizes{ Sizes... };
+
+	static_assert([] {
+		for (size_t i = 1; i < sizes.size(); i++) {
+			if (sizes[i - 1] >= sizes[i]) {
+				return false;
+			}
+		}
+		return true;
+	}(), "Sizes must be strictly increasing.");
+
+	template <size_t Size>
+	struct alignas(std::min(Size & -Size, alignof(std::max_align_t))) Block {
+		std::byte buffer[Size];
+	};
+
+	std::tuple<Allocator<Block<Sizes>, size_t{ 1 } << 6, size_t{ 1 } << 16, ChunkSource>...> allocators;
+
+	//容纳 size 字节、按 align 对齐的最小 size class，不存在时为 sizeof...(Sizes)
+	[[nodiscard]] static constexpr size_t ClassOf(size_t size, size_t align) noexcept {
+		constexpr std::array<size_t, sizeof...(Sizes)> aligns{ alignof(Block<Sizes>)... };
+		size_t i = 0;
+		while (i != sizes.size() && (sizes[i] < size || aligns[i] < align)) {
+			i++;
+		}
+		return i;
+	}
+
+public:
+	static constexpr size_t class_count = sizeof...(Sizes);
+
+	template <size_t Size, size_t Align = alignof(std::max_align_t)>
+	static constexpr size_t class_of = ClassOf(Size, Align);
+
+	template <size_t Size, size_t Align = alignof(std::max_align_t)>
+	static constexpr bool fits = class_of<Size, Align> != class_count;
+
+	template <size_t Size, size_t Align = alignof(std::max_align_t)>
+	static constexpr size_t class_size = sizes[class_of<Size, Align>];
+
+	constexpr BasicStaticPool() noexcept = default;
+
+	//每个 size class 的 Allocator 都复制一份 chunk_source
+	constexpr explicit BasicStaticPool(const ChunkSource& chunk_source) noexcept: allocators{ (static_cast<void>(Sizes), chunk_source)... } {}
+
+	BasicStaticPool(const BasicStaticPool&) = delete;
+	BasicStaticPool& operator=(const BasicStaticPool&) = delete;
+
+	//常量求值时改用 std::allocator，分配的内存必须在同一次求值中回收
+	template <typename T>
+	[[nodiscard]] constexpr T* allocate() {
+		static_assert(fits<sizeof(T), alignof(T)>, "No size class fits T.");
+		if (std::is_constant_evaluated()) {
+			return std::allocator<T>{}.allocate(1);
+		}
+		return reinterpret_cast<T*>(std::get<class_of<sizeof(T), alignof(T)>>(allocators).allocate());
+	}
+
+	template <typename T>
+	constexpr void deallocate(T* p) {
+		static_assert(fits<sizeof(T), alignof(T)>, "No size class fits T.");
+		if (std::is_constant_evaluated()) {
+			std::allocator<T>{}.deallocate(p, 1);
+			return;
+		}
+		std::get<class_of<sizeof(T), alignof(T)>>(allocators).deallocate(reinterpret_cast<Block<class_size<sizeof(T), alignof(T)>>*>(p));
+	}
+
+	//按编译期的大小与对齐分配原始内存
+	template <size_t Size, size_t Align = alignof(std::max_align_t)>
+	[[nodiscard]] void* allocate_bytes() {
+		static_assert(fits<Size, Align>, "No size class fits the request.");
+		return std::get<class_of<Size, Align>>(allocators).allocate();
+	}
+
+	template <size_t Size, size_t Align = alignof(std::max_align_t)>
+	void deallocate_bytes(void* p) {
+		static_assert(fits<Size, Align>, "No size class fits the request.");
+		std::get<class_of<Size, Align>>(allocators).deallocate(static_cast<Block<class_size<Size, Align>>*>(p));
+	}
+
+	template <typename T, typename... Args>
+	[[nodiscard]] constexpr T* new_object(Args&& ... args) {
+		const auto p = allocate<T>();
+		try {
+			return std::construct_at(p, std::forward<Args>(args)...);
+		} catch (...) {
+			deallocate(p);
+			throw;
+		}
+	}
+
+	template <typename T>
+	constexpr void delete_object(T* p) {
+		std::destroy_at(p);
+		deallocate(p);
+	}
+
+	//trim 每个 size class，返回归还的字节数
+	constexpr size_t trim() {
+		return std::apply([](auto& ... allocator) { return (size_t{} + ... + allocator.trim()); }, allocators);
+	}
+
+	constexpr void set_trim_threshold(size_t threshold) noexcept {
+		std::apply([threshold](auto& ... allocator) { (allocator.set_trim_threshold(threshold), ...); }, allocators);
+	}
+};
+
+
+template <size_t... Sizes>
+using StaticPool = BasicStaticPool<NewChunkSource, Sizes...>;
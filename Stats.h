@@ -0,0 +1,84 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+//为 1 时 MemoryPool 与 ThreadCache 记录事件计数和大小分布，默认关闭，关闭时计数器为空类，不占空间也没有开销
+#ifndef MEMORY_MANAGER_STATS
+#define MEMORY_MANAGER_STATS 0
+#endif
+
+
+//Counters 的快照，events 按 Event 下标，histogram 按大小分类下标
+template <typename Event, size_t HistogramSize>
+struct CounterSnapshot {
+	uint64_t events[static_cast<size_t>(Event::count)]{};
+	uint64_t histogram[HistogramSize]{};
+
+	[[nodiscard]] constexpr uint64_t operator[](Event event) const noexcept {
+		return events[static_cast<size_t>(event)];
+	}
+};
+
+
+//每个线程固定写入其中一个分片，分片按缓存行对齐，只用 relaxed 原子操作；读取时汇总所有分片
+template <typename Event, size_t HistogramSize, bool Enabled = MEMORY_MANAGER_STATS>
+class Counters {
+	static constexpr size_t shard_count = 16;
+
+	struct alignas(64) Shard {
+		std::atomic<uint64_t> events[static_cast<size_t>(Event::count)]{};
+		std::atomic<uint64_t> histogram[HistogramSize]{};
+	};
+
+	Shard shards[shard_count]{};
+
+public:
+	void add(Event event, uint64_t n = 1) noexcept {
+		shards[ShardIndex()].events[static_cast<size_t>(event)].fetch_add(n, std::memory_order_relaxed);
+	}
+
+	//index 须小于 HistogramSize
+	void record(size_t index, uint64_t n = 1) noexcept {
+		shards[ShardIndex()].histogram[index].fetch_add(n, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] CounterSnapshot<Event, HistogramSize> snapshot() const noexcept {
+		CounterSnapshot<Event, HistogramSize> ret;
+		for (const auto& shard : shards) {
+			for (size_t i = 0; i != static_cast<size_t>(Event::count); ++i) {
+				ret.events[i] += shard.events[i].load(std::memory_order_relaxed);
+			}
+			for (size_t i = 0; i != HistogramSize; ++i) {
+				ret.histogram[i] += shard.histogram[i].load(std::memory_order_relaxed);
+			}
+		}
+		return ret;
+	}
+
+private:
+	//线程首次计数时按顺序领取分片
+	[[nodiscard]] static size_t ShardIndex() noexcept {
+		static std::atomic<size_t> next{};
+		thread_local const auto index = next.fetch_add(1, std::memory_order_relaxed) % shard_count;
+		return index;
+	}
+};
+
+template <typename Event, size_t HistogramSize>
+class Counters<Event, HistogramSize, false> {
+public:
+	constexpr void add(Event, uint64_t = 1) noexcept {}
+
+	constexpr void record(size_t, uint64_t = 1) noexcept {}
+
+	[[nodiscard]] constexpr CounterSnapshot<Event, HistogramSize> snapshot() const noexcept {
+		return {};
+	}
+};
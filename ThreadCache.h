@@ -0,0 +1,229 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include "MemoryPool.h"
+#include "Stats.h"
+
+
+//MEMORY_MANAGER_STATS 为 1 时记录的事件
+enum class CacheEvent : size_t {
+	hit, //从本线程缓存分配
+	miss, //缓存为空，需要 refill
+	refill,
+	spill,
+	backend, //超出 size class 范围，直接访问后端
+	count
+};
+
+
+class ThreadCache {
+	static constexpr size_t alignment = alignof(std::max_align_t); //与后端的对齐粒度一致
+	static constexpr size_t max_size = 256; //更大的请求直接加锁访问后端
+	static constexpr size_t class_count = max_size / alignment;
+	static constexpr size_t batch_bytes = size_t{ 1 } << 11; //每次批量补充的字节数，需小于后端直接向系统申请的大小
+
+	struct FreeObject {
+		FreeObject* next;
+	};
+
+	struct Bucket {
+		FreeObject* head{};
+		size_t count{};
+	};
+
+	Bucket buckets[class_count]{};
+
+public:
+	//按 size class 统计分配次数
+	using CacheCounterSnapshot = CounterSnapshot<CacheEvent, class_count>;
+
+private:
+	using CacheCounters = Counters<CacheEvent, class_count>;
+
+	ThreadCache() noexcept {
+		//保证后端先于线程缓存构造、后于线程缓存析构
+		static_cast<void>(backend());
+		static_cast<void>(backend_mutex());
+		static_cast<void>(counters());
+	}
+
+	~ThreadCache() noexcept {
+		std::lock_guard lock{ backend_mutex() };
+		Flush();
+	}
+
+public:
+	ThreadCache(const ThreadCache&) = delete;
+	ThreadCache& operator=(const ThreadCache&) = delete;
+
+	static ThreadCache& local() noexcept {
+		thread_local ThreadCache cache;
+		return cache;
+	}
+
+public:
+	[[nodiscard, gnu::alloc_size(2), gnu::alloc_align(3)]] void* allocate(size_t size, size_t align = alignment) {
+		if (size == 0) {
+			return nullptr;
+		}
+
+		if (size > max_size || align > alignment) {
+			counters().add(CacheEvent::backend);
+			std::lock_guard lock{ backend_mutex() };
+			return backend().allocate(size, align);
+		}
+
+		const auto index = class_index(size);
+		auto& bucket = buckets[index];
+		counters().record(index);
+		if (bucket.head == nullptr) {
+			counters().add(CacheEvent::miss);
+			Refill(index);
+		} else {
+			counters().add(CacheEvent::hit);
+		}
+		--bucket.count;
+		return std::exchange(bucket.head, bucket.head->next);
+	}
+
+	[[nodiscard, gnu::alloc_size(2)]] void* allocate(size_t size, std::align_val_t align) {
+		return allocate(size, static_cast<size_t>(align));
+	}
+
+	void deallocate(void* p, size_t size, size_t align = alignment) {
+		if (p == nullptr || size == 0) {
+			return;
+		}
+
+		if (size > max_size || align > alignment) {
+			std::lock_guard lock{ backend_mutex() };
+			backend().deallocate(p, size, align);
+			return;
+		}
+
+		const auto index = class_index(size);
+		auto& bucket = buckets[index];
+		bucket.head = new(p) FreeObject{ bucket.head };
+		if (++bucket.count > 2 * batch_count(index)) {
+			Spill(index);
+		}
+	}
+
+	void deallocate(void* p, size_t size, std::align_val_t align) {
+		deallocate(p, size, static_cast<size_t>(align));
+	}
+
+	//将本线程缓存的对象全部归还后端，再 trim 后端，返回归还的字节数
+	size_t trim() {
+		std::lock_guard lock{ backend_mutex() };
+		Flush();
+		return backend().trim();
+	}
+
+	//本线程缓存中空闲对象的字节数
+	[[nodiscard]] size_t cached_bytes() const noexcept {
+		size_t ret = 0;
+		for (size_t index = 0; index != class_count; ++index) {
+			ret += buckets[index].count * class_size(index);
+		}
+		return ret;
+	}
+
+	//所有线程计数之和
+	[[nodiscard]] static CacheCounterSnapshot counter_snapshot() noexcept {
+		return counters().snapshot();
+	}
+
+	//后端的统计，其空闲字节数不包括各线程缓存中的对象
+	[[nodiscard]] static MemoryPoolStats backend_stats() {
+		std::lock_guard lock{ backend_mutex() };
+		return backend().stats();
+	}
+
+	template <typename T>
+	[[nodiscard]] T* allocate() {
+		return static_cast<T*>(allocate(sizeof(T), alignof(T)));
+	}
+
+	template <typename T>
+	void deallocate(T* p) {
+		deallocate(p, sizeof(T), alignof(T));
+	}
+
+private:
+	//ThreadCache 独占的后端，只在 backend_mutex 中访问；不使用 MemoryPool::instance()，以免与不加锁直接使用它的 PoolResource、PoolAllocator 等竞争
+	static MemoryPool& backend() noexcept {
+		static MemoryPool pool;
+		return pool;
+	}
+
+	static std::mutex& backend_mutex() noexcept {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static CacheCounters& counters() noexcept {
+		static CacheCounters inst;
+		return inst;
+	}
+
+	[[nodiscard]] static constexpr size_t class_index(size_t size) noexcept {
+		return (size - 1) / alignment;
+	}
+
+	[[nodiscard]] static constexpr size_t class_size(size_t index) noexcept {
+		return (index + 1) * alignment;
+	}
+
+	[[nodiscard]] static constexpr size_t batch_count(size_t index) noexcept {
+		return batch_bytes / class_size(index);
+	}
+
+	//从后端批量取一批对象挂到桶上；后端的小对象都位于 slab 中，因此也可以不带 size 回收
+	void Refill(size_t index) {
+		counters().add(CacheEvent::refill);
+		const auto count = batch_count(index);
+
+		void* objects[batch_bytes / alignment];
+		{
+			std::lock_guard lock{ backend_mutex() };
+			backend().allocate_n(class_size(index), count, objects);
+		}
+
+		auto& bucket = buckets[index];
+		for (auto it = objects + count; it != objects;) {
+			bucket.head = new(*--it) FreeObject{ bucket.head };
+		}
+		bucket.count += count;
+	}
+
+	//调用者须持有 backend_mutex
+	void Flush() noexcept {
+		for (size_t index = 0; index != class_count; ++index) {
+			auto& bucket = buckets[index];
+			while (bucket.head != nullptr) {
+				backend().deallocate(std::exchange(bucket.head, bucket.head->next), class_size(index));
+			}
+			bucket.count = 0;
+		}
+	}
+
+	//将一半的缓存对象整批压入后端的 RemoteFreeList，无需加锁，由后端下次分配时取回
+	void Spill(size_t index) {
+		counters().add(CacheEvent::spill);
+		const auto count = batch_count(index);
+		auto& bucket = buckets[index];
+
+		void* objects[batch_bytes / alignment];
+		for (size_t i = 0; i != count; ++i) {
+			objects[i] = std::exchange(bucket.head, bucket.head->next);
+		}
+		bucket.count -= count;
+		backend().deallocate_remote_n({ objects, count });
+	}
+};
@@ -0,0 +1,324 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#pragma once
+
+#include <utility>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+
+//TLSF 的分类索引：一级按 2 的幂划分，二级将每个区间再等分为 sl_count 份，位图记录非空的分类
+//Ref 是链表中引用节点的方式，Ref{} 表示没有；节点须有 next_free 与 prev_free 两个 Ref，由调用者传入的 resolve 将 Ref 换成节点的地址
+//只含整数与 Ref，Ref 为偏移时可以放在跨进程共享的映射中
+template <typename Ref>
+struct TlsfIndex {
+	static constexpr size_t sl_bits = 4;
+	static constexpr size_t sl_count = size_t{ 1 } << sl_bits;
+	static constexpr size_t fl_count = std::numeric_limits<uint64_t>::digits - sl_bits + 1;
+
+	uint64_t fl_bitmap{};
+	uint64_t sl_bitmap[fl_count]{};
+	Ref heads[fl_count][sl_count]{};
+
+	[[nodiscard]] static constexpr std::pair<size_t, size_t> Mapping(size_t size) noexcept {
+		if (size < sl_count) {
+			return { 0, size };
+		}
+		const size_t log = std::bit_width(size) - 1;
+		return { log - sl_bits + 1, (size >> (log - sl_bits)) ^ sl_count };
+	}
+
+	//向上取整到下一个分类的起点，保证找到的分类中任意节点都足够大
+	[[nodiscard]] static constexpr size_t RoundUp(size_t size) noexcept {
+		if (size < sl_count) {
+			return size;
+		}
+		const auto round = (size_t{ 1 } << (std::bit_width(size) - 1 - sl_bits)) - 1;
+		return size + round;
+	}
+
+	//size 所在分类的表头
+	[[nodiscard]] constexpr Ref head(size_t size) const noexcept {
+		const auto [fl, sl] = Mapping(size);
+		return heads[fl][sl];
+	}
+
+	//其中任意节点都不小于 size 的最小非空分类的表头，没有时返回 Ref{}
+	[[nodiscard]] constexpr Ref find(size_t size) const noexcept {
+		auto [fl, sl] = Mapping(RoundUp(size));
+		if (fl >= fl_count) {
+			return Ref{};
+		}
+		if (const auto sl_map = sl_bitmap[fl] & (~uint64_t{} << sl); sl_map != 0) {
+			return heads[fl][std::countr_zero(sl_map)];
+		}
+		if (fl + 1 >= fl_count) {
+			return Ref{};
+		}
+		const auto fl_map = fl_bitmap & (~uint64_t{} << (fl + 1));
+		if (fl_map == 0) {
+			return Ref{};
+		}
+		fl = std::countr_zero(fl_map);
+		return heads[fl][std::countr_zero(sl_bitmap[fl])];
+	}
+
+	//最大的非空分类的表头，其中的节点不一定是最大的
+	[[nodiscard]] constexpr Ref last() const noexcept {
+		if (fl_bitmap == 0) {
+			return Ref{};
+		}
+		const size_t fl = std::bit_width(fl_bitmap) - 1;
+		return heads[fl][std::bit_width(sl_bitmap[fl]) - 1];
+	}
+
+	template <typename Resolve>
+	constexpr void link(Ref node, size_t size, Resolve resolve) noexcept {
+		const auto [fl, sl] = Mapping(size);
+		const auto p = resolve(node);
+		p->prev_free = Ref{};
+		p->next_free = heads[fl][sl];
+		if (p->next_free != Ref{}) {
+			resolve(p->next_free)->prev_free = node;
+		}
+		heads[fl][sl] = node;
+		fl_bitmap |= uint64_t{ 1 } << fl;
+		sl_bitmap[fl] |= uint64_t{ 1 } << sl;
+	}
+
+	//size 须与 link 时相同
+	template <typename Resolve>
+	constexpr void unlink(Ref node, size_t size, Resolve resolve) noexcept {
+		const auto [fl, sl] = Mapping(size);
+		const auto p = resolve(node);
+		if (p->next_free != Ref{}) {
+			resolve(p->next_free)->prev_free = p->prev_free;
+		}
+		if (p->prev_free != Ref{}) {
+			resolve(p->prev_free)->next_free = p->next_free;
+		} else if ((heads[fl][sl] = p->next_free) == Ref{}) {
+			if ((sl_bitmap[fl] &= ~(uint64_t{ 1 } << sl)) == 0) {
+				fl_bitmap &= ~(uint64_t{ 1 } << fl);
+			}
+		}
+	}
+};
+
+
+//块头中的引用直接是指针
+template <typename Node>
+struct PointerAddressing {
+	using Ref = Node*;
+
+	[[nodiscard]] static constexpr Node* get(Ref ref) noexcept {
+		return ref;
+	}
+
+	[[nodiscard]] static constexpr Ref ref(Node* node) noexcept {
+		return node;
+	}
+};
+
+
+/*
+ * 经典 TLSF 的块布局以及切分与合并，allocate 与 deallocate 最坏情况都是 O(1)。
+ * 每块之前有 16 字节的块头，记录大小与物理上的前一块；空闲块的 payload 中存放同一分类的双向链表，合并只看物理上相邻的两块。
+ * 块头中的引用由 Addressing<BlockHeader> 表示，RealTimePool 使用指针，MappedPool 使用相对映射起点的偏移。
+ * TlsfHeap 本身只是 State 的视图，State 可以是对象的成员，也可以放在跨进程共享的映射中。
+ */
+template <template <typename> typename Addressing>
+class TlsfHeap {
+public:
+	static constexpr size_t alignment = alignof(std::max_align_t);
+
+	struct BlockHeader;
+
+	using Ref = typename Addressing<BlockHeader>::Ref;
+
+	struct BlockHeader {
+		Ref prev_physical;
+		uint64_t size; //包括块头在内，低 2 位为 free_bit 与 prev_free_bit
+
+		//以下两项只在空闲时有效，位于 payload 中
+		Ref next_free;
+		Ref prev_free;
+
+		[[nodiscard]] constexpr size_t bytes() const noexcept {
+			return size & ~(alignment - 1);
+		}
+
+		[[nodiscard]] constexpr bool is_free() const noexcept {
+			return (size & free_bit) != 0;
+		}
+
+		[[nodiscard]] constexpr bool is_prev_free() const noexcept {
+			return (size & prev_free_bit) != 0;
+		}
+
+		[[nodiscard]] std::byte* payload() noexcept {
+			return reinterpret_cast<std::byte*>(this) + header_size;
+		}
+
+		[[nodiscard]] BlockHeader* next_physical() noexcept {
+			return reinterpret_cast<BlockHeader*>(reinterpret_cast<std::byte*>(this) + bytes());
+		}
+
+		[[nodiscard]] static BlockHeader* of(void* p) noexcept {
+			return reinterpret_cast<BlockHeader*>(static_cast<std::byte*>(p) - header_size);
+		}
+	};
+
+	static constexpr uint64_t free_bit = 1;
+	static constexpr uint64_t prev_free_bit = 2;
+	static constexpr size_t header_size = offsetof(BlockHeader, next_free);
+	static constexpr size_t min_block_size = sizeof(BlockHeader);
+	static constexpr size_t max_size = std::numeric_limits<size_t>::max() >> 2; //更大的 size 或 align 在计算块大小时可能溢出
+
+	static_assert(header_size == alignment && min_block_size % alignment == 0);
+
+	struct State {
+		TlsfIndex<Ref> index{};
+		uint64_t free_count{};
+		uint64_t free_bytes{};
+	};
+
+private:
+	State& state;
+	[[no_unique_address]] Addressing<BlockHeader> addressing;
+
+public:
+	constexpr TlsfHeap(State& state, Addressing<BlockHeader> addressing) noexcept: state(state), addressing(std::move(addressing)) {}
+
+	//[p, p + bytes) 最前面是一个空闲块，最后是一个已分配的空块头，作为合并的边界；bytes 须是 alignment 的倍数且不小于 min_block_size + header_size
+	void format(std::byte* p, size_t bytes) noexcept {
+		const auto block = reinterpret_cast<BlockHeader*>(p);
+		const auto sentinel = reinterpret_cast<BlockHeader*>(p + bytes - header_size);
+		block->prev_physical = Ref{};
+		block->size = (bytes - header_size) | free_bit;
+		sentinel->prev_physical = addressing.ref(block);
+		sentinel->size = prev_free_bit;
+		Link(block);
+		state.free_bytes = block->bytes();
+	}
+
+	//size 不为 0，align 须为 2 的幂；空间不足时返回 nullptr
+	[[nodiscard]] void* allocate(size_t size, size_t align) noexcept {
+		if (size > max_size || align > max_size) {
+			return nullptr;
+		}
+
+		const auto bytes = std::max(((size + alignment - 1) & ~(alignment - 1)) + header_size, min_block_size);
+		align = std::max(align, alignment);
+		//对齐时前部空隙不足一个块则再向后移 align，因此多查找 align + min_block_size 字节
+		const auto found = state.index.find(align == alignment ? bytes : bytes + align + min_block_size);
+		if (found == Ref{}) {
+			return nullptr;
+		}
+
+		auto block = addressing.get(found);
+		if (align != alignment) {
+			auto payload = reinterpret_cast<std::byte*>((reinterpret_cast<std::uintptr_t>(block->payload()) + align - 1) & ~(align - 1));
+			if (payload != block->payload() && static_cast<size_t>(payload - block->payload()) < min_block_size) {
+				payload += align;
+			}
+			if (const auto gap = static_cast<size_t>(payload - block->payload()); gap != 0) {
+				//前部空隙仍是原空闲块，其后的部分成为新的空闲块
+				Unlink(block);
+				state.free_bytes -= block->bytes();
+				const auto rest = block->bytes() - gap;
+				const auto next = BlockHeader::of(payload);
+				next->size = 0;
+				MarkFree(block, gap);
+				MarkFree(next, rest);
+				block = next;
+			}
+		}
+
+		Use(block, bytes);
+		return block->payload();
+	}
+
+	//与物理上相邻的空闲块立即合并，返回合并的次数
+	size_t deallocate(void* p) noexcept {
+		size_t merges = 0;
+		auto block = BlockHeader::of(p);
+		auto bytes = block->bytes();
+		if (const auto next = block->next_physical(); next->is_free()) {
+			Unlink(next);
+			state.free_bytes -= next->bytes();
+			bytes += next->bytes();
+			++merges;
+		}
+		if (block->is_prev_free()) {
+			const auto prev = addressing.get(block->prev_physical);
+			Unlink(prev);
+			state.free_bytes -= prev->bytes();
+			bytes += prev->bytes();
+			block = prev;
+			++merges;
+		}
+		MarkFree(block, bytes);
+		return merges;
+	}
+
+	[[nodiscard]] static size_t usable_size(void* p) noexcept {
+		return BlockHeader::of(p)->bytes() - header_size;
+	}
+
+	//p 是否可能由 allocate(size, align) 返回：可用字节不少于 size 且多出的部分不足以切出一块，地址满足 align
+	[[nodiscard]] static bool matches(void* p, size_t size, size_t align) noexcept {
+		const auto usable = usable_size(p);
+		return usable >= size && usable < size + min_block_size + alignment && (reinterpret_cast<std::uintptr_t>(p) & (std::max(align, alignment) - 1)) == 0;
+	}
+
+	//最大空闲块的字节数，只扫描最大的非空分类；不修改 state，可在只读的场合调用
+	[[nodiscard]] static size_t largest(const State& state, const Addressing<BlockHeader>& addressing) noexcept {
+		size_t ret = 0;
+		for (auto it = state.index.last(); it != Ref{}; it = addressing.get(it)->next_free) {
+			ret = std::max(ret, addressing.get(it)->bytes());
+		}
+		return ret;
+	}
+
+private:
+	void Link(BlockHeader* block) noexcept {
+		state.index.link(addressing.ref(block), block->bytes(), [this](Ref ref) { return addressing.get(ref); });
+		++state.free_count;
+	}
+
+	void Unlink(BlockHeader* block) noexcept {
+		state.index.unlink(addressing.ref(block), block->bytes(), [this](Ref ref) { return addressing.get(ref); });
+		--state.free_count;
+	}
+
+	//将 block 设为空闲并挂到分类上，同时更新物理上的后一块
+	void MarkFree(BlockHeader* block, size_t bytes) noexcept {
+		block->size = bytes | free_bit | (block->size & prev_free_bit);
+		const auto next = block->next_physical();
+		next->prev_physical = addressing.ref(block);
+		next->size |= prev_free_bit;
+		Link(block);
+		state.free_bytes += bytes;
+	}
+
+	//从空闲块 block 的开头切出 bytes 字节，剩余部分不小于 min_block_size 时作为新的空闲块
+	void Use(BlockHeader* block, size_t bytes) noexcept {
+		Unlink(block);
+		state.free_bytes -= block->bytes();
+		if (const auto rest = block->bytes() - bytes; rest >= min_block_size) {
+			block->size = bytes | (block->size & prev_free_bit);
+			const auto tail = block->next_physical();
+			tail->prev_physical = addressing.ref(block);
+			tail->size = 0; //前一块已分配
+			MarkFree(tail, rest);
+		} else {
+			block->size &= ~free_bit;
+			block->next_physical()->size &= ~prev_free_bit;
+		}
+	}
+};
@@ -0,0 +1,469 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Allocator.h"
+#include "ConcurrentAllocator.h"
+#include "DenseAllocator.h"
+#include "MemoryPool.h"
+#include "NumaMemoryPool.h"
+#include "RealTimePool.h"
+#include "ThreadCache.h"
+
+
+/*
+ * 同一份代码链接不同的 malloc 实现（glibc、jemalloc、mimalloc、tcmalloc）生成多个可执行文件，
+ * Malloc 一项即代表所链接的 malloc，其余各项为本仓库的内存池。
+ */
+
+namespace {
+	struct Node {
+		std::byte payload[64];
+	};
+
+	struct Malloc {
+		static void* allocate(size_t size) {
+			return std::malloc(size);
+		}
+
+		static void deallocate(void* p, size_t) {
+			std::free(p);
+		}
+	};
+
+	struct Pool {
+		static void* allocate(size_t size) {
+			return MemoryPool::instance().allocate(size);
+		}
+
+		static void deallocate(void* p, size_t size) {
+			MemoryPool::instance().deallocate(p, size);
+		}
+	};
+
+	struct Cache {
+		static void* allocate(size_t size) {
+			return ThreadCache::local().allocate(size);
+		}
+
+		static void deallocate(void* p, size_t size) {
+			ThreadCache::local().deallocate(p, size);
+		}
+	};
+
+	struct Numa {
+		static void* allocate(size_t size) {
+			return NumaMemoryPool<>::instance().allocate(size);
+		}
+
+		static void deallocate(void* p, size_t size) {
+			NumaMemoryPool<>::instance().deallocate(p, size);
+		}
+	};
+
+	//预留 64 MiB，足够容纳各项测试同时存活的对象
+	struct RealTime {
+		static RealTimePool& instance() {
+			static RealTimePool pool{ size_t{ 1 } << 26 };
+			return pool;
+		}
+
+		static void* allocate(size_t size) {
+			return instance().allocate(size);
+		}
+
+		static void deallocate(void* p, size_t size) {
+			instance().deallocate(p, size);
+		}
+	};
+
+	//定长对象只比较 Node
+	struct FixedMalloc : Malloc {};
+
+	struct FixedAllocator {
+		static Allocator<Node>& instance() {
+			static Allocator<Node> allocator;
+			return allocator;
+		}
+
+		static void* allocate(size_t) {
+			return instance().allocate();
+		}
+
+		static void deallocate(void* p, size_t) {
+			instance().deallocate(static_cast<Node*>(p));
+		}
+	};
+
+	struct FixedDense {
+		static DenseAllocator<Node>& instance() {
+			static DenseAllocator<Node> allocator;
+			return allocator;
+		}
+
+		static void* allocate(size_t) {
+			return instance().allocate();
+		}
+
+		static void deallocate(void* p, size_t) {
+			instance().deallocate(static_cast<Node*>(p));
+		}
+
+		template <typename F>
+		static void for_each(const std::vector<void*>&, F&& f) {
+			instance().for_each(f);
+		}
+	};
+
+	struct FixedConcurrent {
+		static ConcurrentAllocator<Node>& instance() {
+			static ConcurrentAllocator<Node> allocator;
+			return allocator;
+		}
+
+		static void* allocate(size_t) {
+			return instance().allocate();
+		}
+
+		static void deallocate(void* p, size_t) {
+			instance().deallocate(static_cast<Node*>(p));
+		}
+	};
+
+
+	[[nodiscard]] double PeakRssMiB() noexcept {
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<double>(usage.ru_maxrss) / 1024;
+	}
+
+	[[nodiscard]] double CurrentRssMiB() {
+		size_t pages = 0, resident = 0;
+		std::ifstream{ "/proc/self/statm" } >> pages >> resident;
+		return static_cast<double>(resident * sysconf(_SC_PAGESIZE)) / (1 << 20);
+	}
+
+	//16 到 max_size 字节，小对象居多
+	[[nodiscard]] size_t RandomSize(std::minstd_rand& rng, size_t max_size) {
+		const auto log = std::uniform_int_distribution<size_t>{ 4, std::bit_width(max_size) - 1 }(rng);
+		return std::uniform_int_distribution<size_t>{ size_t{ 1 } << (log - 1), size_t{ 1 } << log }(rng);
+	}
+
+	void ReportMemory(benchmark::State& state) {
+		state.counters["peak_rss_MiB"] = PeakRssMiB();
+		state.counters["rss_MiB"] = CurrentRssMiB();
+	}
+
+
+	//单线程同一大小分配后立即回收
+	template <typename Impl>
+	void PingPong(benchmark::State& state) {
+		const auto size = static_cast<size_t>(state.range(0));
+		for (auto _ : state) {
+			const auto p = Impl::allocate(size);
+			benchmark::DoNotOptimize(p);
+			Impl::deallocate(p, size);
+		}
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//Larson：每个线程维护一组槽位，随机替换其中的对象
+	template <typename Impl>
+	void Churn(benchmark::State& state) {
+		constexpr size_t slot_count = 1 << 12;
+		const auto max_size = static_cast<size_t>(state.range(0));
+
+		std::minstd_rand rng(state.thread_index() + 1);
+		std::vector<std::pair<void*, size_t>> slots(slot_count);
+		for (auto& [p, size] : slots) {
+			size = RandomSize(rng, max_size);
+			p = Impl::allocate(size);
+		}
+
+		for (auto _ : state) {
+			auto& [p, size] = slots[rng() % slot_count];
+			Impl::deallocate(p, size);
+			size = RandomSize(rng, max_size);
+			p = Impl::allocate(size);
+			static_cast<std::byte*>(p)[0] = std::byte{ 1 };
+		}
+
+		for (auto [p, size] : slots) {
+			Impl::deallocate(p, size);
+		}
+		state.SetItemsProcessed(state.iterations());
+		if (state.thread_index() == 0) {
+			ReportMemory(state);
+		}
+	}
+
+	//延迟分布：逐次计时 allocate + deallocate
+	template <typename Impl>
+	void Latency(benchmark::State& state) {
+		constexpr size_t slot_count = 1 << 12;
+		const auto max_size = static_cast<size_t>(state.range(0));
+
+		std::minstd_rand rng(1);
+		std::vector<std::pair<void*, size_t>> slots(slot_count);
+		for (auto& [p, size] : slots) {
+			size = RandomSize(rng, max_size);
+			p = Impl::allocate(size);
+		}
+
+		std::vector<double> samples;
+		samples.reserve(1 << 20);
+		for (auto _ : state) {
+			auto& [p, size] = slots[rng() % slot_count];
+			const auto new_size = RandomSize(rng, max_size);
+			const auto begin = std::chrono::steady_clock::now();
+			Impl::deallocate(p, size);
+			p = Impl::allocate(new_size);
+			const auto end = std::chrono::steady_clock::now();
+			size = new_size;
+			if (samples.size() < samples.capacity()) {
+				samples.push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+			}
+		}
+
+		for (auto [p, size] : slots) {
+			Impl::deallocate(p, size);
+		}
+
+		std::sort(samples.begin(), samples.end());
+		const auto percentile = [&samples](double q) {
+			return samples.empty() ? 0.0 : samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+		};
+		state.counters["p50_ns"] = percentile(0.5);
+		state.counters["p99_ns"] = percentile(0.99);
+		state.counters["p999_ns"] = percentile(0.999);
+		state.counters["max_ns"] = samples.empty() ? 0.0 : samples.back();
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//x86 上为 TSC 周期，其他平台退化为 steady_clock 的计数
+	[[nodiscard]] uint64_t Cycles() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	//与 Latency 相同的随机替换，分别计时每次 allocate 与 deallocate 的周期数
+	//range(1) 为周期预算，非 0 时 p99.99 超出预算即报错；最大值受中断与调度影响，只报告不校验
+	template <typename Impl>
+	void CycleBudget(benchmark::State& state) {
+		constexpr size_t slot_count = 1 << 12;
+		const auto max_size = static_cast<size_t>(state.range(0));
+		const auto budget = static_cast<double>(state.range(1));
+
+		std::minstd_rand rng(1);
+		std::vector<std::pair<void*, size_t>> slots(slot_count);
+		for (auto& [p, size] : slots) {
+			size = RandomSize(rng, max_size);
+			p = Impl::allocate(size);
+		}
+
+		std::vector<double> samples;
+		samples.reserve(1 << 21);
+		for (auto _ : state) {
+			auto& [p, size] = slots[rng() % slot_count];
+			const auto new_size = RandomSize(rng, max_size);
+			const auto t0 = Cycles();
+			Impl::deallocate(p, size);
+			const auto t1 = Cycles();
+			p = Impl::allocate(new_size);
+			const auto t2 = Cycles();
+			size = new_size;
+			if (samples.size() + 2 <= samples.capacity()) {
+				samples.push_back(static_cast<double>(t1 - t0));
+				samples.push_back(static_cast<double>(t2 - t1));
+			}
+		}
+
+		for (auto [p, size] : slots) {
+			Impl::deallocate(p, size);
+		}
+
+		std::sort(samples.begin(), samples.end());
+		const auto percentile = [&samples](double q) {
+			return samples.empty() ? 0.0 : samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+		};
+		state.counters["p50_cycles"] = percentile(0.5);
+		state.counters["p9999_cycles"] = percentile(0.9999);
+		state.counters["max_cycles"] = samples.empty() ? 0.0 : samples.back();
+		state.SetItemsProcessed(state.iterations());
+		if (budget != 0 && percentile(0.9999) > budget) {
+			state.SkipWithError("p99.99 exceeds the cycle budget");
+		}
+	}
+
+	//xmalloc-test：生产者线程分配，消费者线程回收
+	template <typename Impl>
+	void ProducerConsumer(benchmark::State& state) {
+		constexpr size_t ring_size = 1 << 10;
+		std::vector<std::atomic<void*>> ring(ring_size);
+		std::atomic<bool> done{ false };
+
+		std::thread consumer{ [&] {
+			for (size_t index = 0;; index = (index + 1) % ring_size) {
+				void* p;
+				while ((p = ring[index].exchange(nullptr, std::memory_order_acquire)) == nullptr) {
+					if (done.load(std::memory_order_acquire)) {
+						return;
+					}
+				}
+				Impl::deallocate(p, sizeof(Node));
+			}
+		} };
+
+		size_t index = 0;
+		for (auto _ : state) {
+			const auto p = Impl::allocate(sizeof(Node));
+			while (ring[index].load(std::memory_order_relaxed) != nullptr) {
+			}
+			ring[index].store(p, std::memory_order_release);
+			index = (index + 1) % ring_size;
+		}
+
+		//等待消费者取空后再结束
+		for (auto& slot : ring) {
+			while (slot.load(std::memory_order_acquire) != nullptr) {
+			}
+		}
+		done.store(true, std::memory_order_release);
+		consumer.join();
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//碎片化：反复分配一批随机大小的对象再随机回收一半，报告 RSS 与存活字节数之比
+	template <typename Impl>
+	void Fragmentation(benchmark::State& state) {
+		constexpr size_t batch = 1 << 14;
+		const auto max_size = static_cast<size_t>(state.range(0));
+
+		std::minstd_rand rng(1);
+		std::vector<std::pair<void*, size_t>> live;
+		size_t live_bytes = 0;
+		for (auto _ : state) {
+			for (size_t i = 0; i != batch; ++i) {
+				const auto size = RandomSize(rng, max_size);
+				live.emplace_back(Impl::allocate(size), size);
+				live_bytes += size;
+			}
+			std::shuffle(live.begin(), live.end(), rng);
+			for (auto i = live.size() / 2; i != live.size(); ++i) {
+				Impl::deallocate(live[i].first, live[i].second);
+				live_bytes -= live[i].second;
+			}
+			live.resize(live.size() / 2);
+		}
+
+		state.counters["live_MiB"] = static_cast<double>(live_bytes) / (1 << 20);
+		ReportMemory(state);
+		state.counters["rss_per_live"] = state.counters["rss_MiB"] / std::max(static_cast<double>(state.counters["live_MiB"]), 1e-9);
+		for (auto [p, size] : live) {
+			Impl::deallocate(p, size);
+		}
+		state.SetItemsProcessed(state.iterations() * batch);
+	}
+
+	//遍历：分配一批 Node 后随机回收四分之三再补回一半，计时按地址顺序访问所有存活的对象；DenseAllocator 使用 for_each，其余各项遍历排序后的指针
+	template <typename Impl>
+	void Scan(benchmark::State& state) {
+		const auto count = static_cast<size_t>(state.range(0));
+
+		std::minstd_rand rng(1);
+		std::vector<void*> live(count);
+		for (auto& p : live) {
+			p = Impl::allocate(sizeof(Node));
+		}
+		std::shuffle(live.begin(), live.end(), rng);
+		for (auto i = count / 4; i != count; ++i) {
+			Impl::deallocate(live[i], sizeof(Node));
+		}
+		live.resize(count / 4);
+		for (size_t i = 0; i != count / 2; ++i) {
+			live.push_back(Impl::allocate(sizeof(Node)));
+		}
+		for (auto p : live) {
+			std::fill_n(static_cast<Node*>(p)->payload, sizeof(Node), std::byte{ 1 });
+		}
+		std::sort(live.begin(), live.end());
+
+		for (auto _ : state) {
+			size_t sum = 0;
+			const auto visit = [&sum](void* p) { sum += std::to_integer<size_t>(static_cast<Node*>(p)->payload[0]); };
+			if constexpr (requires { Impl::for_each(live, visit); }) {
+				Impl::for_each(live, visit);
+			} else {
+				std::for_each(live.begin(), live.end(), visit);
+			}
+			benchmark::DoNotOptimize(sum);
+		}
+
+		for (auto p : live) {
+			Impl::deallocate(p, sizeof(Node));
+		}
+		state.SetItemsProcessed(state.iterations() * live.size());
+	}
+}
+
+
+#define VARIABLE_SIZE_BENCHMARK(name, impl) \
+	BENCHMARK_TEMPLATE(PingPong, impl)->Arg(16)->Arg(64)->Arg(256)->Arg(4096)->Name(#name "/PingPong"); \
+	BENCHMARK_TEMPLATE(Latency, impl)->Arg(1024)->Name(#name "/Latency"); \
+	BENCHMARK_TEMPLATE(Fragmentation, impl)->Arg(4096)->Iterations(16)->Name(#name "/Fragmentation")
+
+#define THREADED_BENCHMARK(name, impl) \
+	BENCHMARK_TEMPLATE(Churn, impl)->Arg(1024)->ThreadRange(1, 16)->UseRealTime()->Name(#name "/Churn")
+
+#define FIXED_SIZE_BENCHMARK(name, impl) \
+	BENCHMARK_TEMPLATE(PingPong, impl)->Arg(sizeof(Node))->Name(#name "/PingPong"); \
+	BENCHMARK_TEMPLATE(Scan, impl)->Arg(1 << 18)->Name(#name "/Scan")
+
+VARIABLE_SIZE_BENCHMARK(Malloc, Malloc);
+VARIABLE_SIZE_BENCHMARK(MemoryPool, Pool);
+VARIABLE_SIZE_BENCHMARK(ThreadCache, Cache);
+VARIABLE_SIZE_BENCHMARK(NumaMemoryPool, Numa);
+
+//周期预算只对 RealTimePool 校验，其余各项作为对照；p50 约 150 周期，预算按虚拟机上中断造成的 p99.99 抖动留出余量，用于发现非 O(1) 的退化
+constexpr int64_t realtime_cycle_budget = 1 << 16;
+BENCHMARK_TEMPLATE(PingPong, RealTime)->Arg(16)->Arg(64)->Arg(256)->Arg(4096)->Name("RealTimePool/PingPong");
+BENCHMARK_TEMPLATE(CycleBudget, RealTime)->Args({ 1 << 14, realtime_cycle_budget })->Name("RealTimePool/CycleBudget");
+BENCHMARK_TEMPLATE(CycleBudget, Malloc)->Args({ 1 << 14, 0 })->Name("Malloc/CycleBudget");
+BENCHMARK_TEMPLATE(CycleBudget, Pool)->Args({ 1 << 14, 0 })->Name("MemoryPool/CycleBudget");
+
+BENCHMARK_TEMPLATE(Churn, Pool)->Arg(1024)->Name("MemoryPool/Churn");
+THREADED_BENCHMARK(Malloc, Malloc);
+THREADED_BENCHMARK(ThreadCache, Cache);
+THREADED_BENCHMARK(NumaMemoryPool, Numa);
+
+FIXED_SIZE_BENCHMARK(FixedMalloc, FixedMalloc);
+FIXED_SIZE_BENCHMARK(Allocator, FixedAllocator);
+FIXED_SIZE_BENCHMARK(ConcurrentAllocator, FixedConcurrent);
+FIXED_SIZE_BENCHMARK(DenseAllocator, FixedDense);
+
+BENCHMARK_TEMPLATE(ProducerConsumer, Malloc)->UseRealTime()->Name("Malloc/ProducerConsumer");
+BENCHMARK_TEMPLATE(ProducerConsumer, Cache)->UseRealTime()->Name("ThreadCache/ProducerConsumer");
+BENCHMARK_TEMPLATE(ProducerConsumer, Numa)->UseRealTime()->Name("NumaMemoryPool/ProducerConsumer");
+BENCHMARK_TEMPLATE(ProducerConsumer, FixedConcurrent)->UseRealTime()->Name("ConcurrentAllocator/ProducerConsumer");
+
+BENCHMARK_MAIN();
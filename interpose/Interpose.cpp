@@ -0,0 +1,399 @@
+/*
+ * Created by WiwilZ on 2026/10/14.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "MemoryPool.h"
+
+
+/*
+ * 以 MemoryPool 替换进程的 malloc 与 operator new，可通过 LD_PRELOAD 加载共享库，或静态链接。
+ * 后端是一个使用 MmapChunkSource 的内存池，由一把锁保护，不超过 256 字节的对象经过无锁的线程缓存。
+ * 实现中不能调用全局的 operator new 或 malloc：后端永不析构，线程缓存是平凡的 thread_local，线程退出时由 pthread key 的析构函数归还。
+ * 持有锁时只调用后端的 try_ 系列：抛出异常要先经 malloc 分配异常对象，会再次请求同一把锁而死锁。
+ */
+
+namespace {
+	using Backend = BasicMemoryPool<size_t{ 1 } << 16, size_t{ 1 } << 22, MmapChunkSource<>>;
+
+	constexpr size_t alignment = alignof(std::max_align_t);
+
+	//与 glibc 相同，超过 PTRDIFF_MAX 的请求直接以 ENOMEM 失败
+	constexpr size_t max_request = PTRDIFF_MAX;
+
+	std::mutex backend_mutex;
+
+	Backend& backend() noexcept {
+		alignas(Backend) static std::byte storage[sizeof(Backend)];
+		static const auto pool = new(storage) Backend{ MmapChunkSource<>{} };
+		return *pool;
+	}
+
+
+	//与 ThreadCache 相同的按 16 字节划分的桶，回收时由后端查出大小
+	struct Cache {
+		static constexpr size_t max_size = 256;
+		static constexpr size_t class_count = max_size / alignment;
+		static constexpr size_t batch_bytes = size_t{ 1 } << 11;
+
+		struct FreeObject {
+			FreeObject* next;
+		};
+
+		struct Bucket {
+			FreeObject* head;
+			size_t count;
+		};
+
+		Bucket buckets[class_count];
+		bool registered;
+	};
+
+	[[gnu::tls_model("initial-exec")]] constinit thread_local Cache cache{};
+
+	constexpr size_t BatchCount(size_t index) noexcept {
+		return Cache::batch_bytes / ((index + 1) * alignment);
+	}
+
+	//调用者须持有 backend_mutex
+	void Flush(Cache& local) noexcept {
+		for (auto& bucket : local.buckets) {
+			while (bucket.head != nullptr) {
+				backend().deallocate(std::exchange(bucket.head, bucket.head->next));
+			}
+			bucket.count = 0;
+		}
+	}
+
+	void OnThreadExit(void* p) noexcept {
+		const auto local = static_cast<Cache*>(p);
+		std::lock_guard lock{ backend_mutex };
+		Flush(*local);
+		local->registered = false;
+	}
+
+	pthread_key_t ThreadExitKey() noexcept {
+		static const auto key = [] {
+			pthread_key_t key;
+			pthread_key_create(&key, OnThreadExit);
+			return key;
+		}();
+		return key;
+	}
+
+	//失败时返回 nullptr
+	void* Allocate(size_t size, size_t align = alignment) noexcept {
+		if (size == 0) {
+			size = 1;
+		}
+		if (size > max_request) {
+			return nullptr;
+		}
+
+		if (size <= Cache::max_size && align <= alignment) {
+			const auto index = (size - 1) / alignment;
+			auto& bucket = cache.buckets[index];
+			if (bucket.head == nullptr) {
+				if (!cache.registered) {
+					cache.registered = true;
+					pthread_setspecific(ThreadExitKey(), &cache);
+				}
+
+				void* objects[Cache::batch_bytes / alignment];
+				size_t count;
+				{
+					std::lock_guard lock{ backend_mutex };
+					count = backend().try_allocate_n((index + 1) * alignment, BatchCount(index), objects);
+				}
+				if (count == 0) {
+					return nullptr;
+				}
+				for (auto it = objects + count; it != objects;) {
+					bucket.head = new(*--it) Cache::FreeObject{ bucket.head };
+				}
+				bucket.count = count;
+			}
+			--bucket.count;
+			return std::exchange(bucket.head, bucket.head->next);
+		}
+
+		std::lock_guard lock{ backend_mutex };
+		return backend().try_allocate(size, align);
+	}
+
+	//读 page map 与块头无需加锁：p 所在页的记录写入在 p 被分配出去之前
+	void Deallocate(void* p) noexcept {
+		if (p == nullptr) {
+			return;
+		}
+
+		if (const auto size = backend().usable_size(p); size <= Cache::max_size) {
+			const auto index = size / alignment - 1;
+			auto& bucket = cache.buckets[index];
+			bucket.head = new(p) Cache::FreeObject{ bucket.head };
+			if (++bucket.count <= 2 * BatchCount(index)) {
+				return;
+			}
+
+			//整批压入后端的 RemoteFreeList，无需加锁
+			void* objects[Cache::batch_bytes / alignment];
+			const auto count = BatchCount(index);
+			for (size_t i = 0; i != count; ++i) {
+				objects[i] = std::exchange(bucket.head, bucket.head->next);
+			}
+			bucket.count -= count;
+			backend().deallocate_remote_n({ objects, count });
+			return;
+		}
+
+		std::lock_guard lock{ backend_mutex };
+		backend().deallocate(p);
+	}
+
+	size_t UsableSize(void* p) noexcept {
+		return p != nullptr ? backend().usable_size(p) : 0;
+	}
+
+	void* AllocateOrThrow(size_t size, size_t align = alignment) {
+		const auto p = Allocate(size, align);
+		if (p == nullptr) {
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+
+	void* AllocateOrErrno(size_t size, size_t align = alignment) noexcept {
+		const auto p = Allocate(size, align);
+		if (p == nullptr) {
+			errno = ENOMEM;
+		}
+		return p;
+	}
+
+	void* Reallocate(void* p, size_t size) noexcept {
+		if (p == nullptr) {
+			return AllocateOrErrno(size);
+		}
+		if (size == 0) {
+			Deallocate(p);
+			return nullptr;
+		}
+		if (size > max_request) {
+			errno = ENOMEM;
+			return nullptr;
+		}
+
+		//两端都不经过线程缓存时由后端原地扩大或缩小
+		const auto old_size = UsableSize(p);
+		if (old_size > Cache::max_size && size > Cache::max_size) {
+			void* ret;
+			{
+				std::lock_guard lock{ backend_mutex };
+				ret = backend().try_reallocate(p, size);
+			}
+			if (ret == nullptr) {
+				errno = ENOMEM;
+			}
+			return ret;
+		}
+		if (size <= old_size) {
+			return p;
+		}
+		const auto ret = AllocateOrErrno(size);
+		if (ret != nullptr) {
+			std::memcpy(ret, p, old_size);
+			Deallocate(p);
+		}
+		return ret;
+	}
+
+	[[nodiscard]] constexpr bool IsValidAlignment(size_t align) noexcept {
+		return align != 0 && std::has_single_bit(align);
+	}
+
+	[[nodiscard]] size_t PageSize() noexcept {
+		static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return page_size;
+	}
+
+	//fork 时持有后端的锁，避免子进程继承一把被其他线程持有的锁；在加载时注册，此时不在 malloc 内部
+	//开启 MEMORY_MANAGER_PROFILE 时先调用一次 backtrace，使其首次加载 libgcc_s 时的 malloc 不发生在持有后端的锁时
+	[[gnu::constructor]] void RegisterAtFork() noexcept {
+		static_cast<void>(ThreadExitKey());
+#if MEMORY_MANAGER_PROFILE
+		void* frame;
+		static_cast<void>(backtrace(&frame, 1));
+#endif
+		pthread_atfork(
+			[] { backend_mutex.lock(); },
+			[] { backend_mutex.unlock(); },
+			[] { backend_mutex.unlock(); }
+		);
+	}
+}
+
+
+extern "C" {
+	void* malloc(size_t size) noexcept {
+		return AllocateOrErrno(size);
+	}
+
+	void free(void* p) noexcept {
+		Deallocate(p);
+	}
+
+	void* calloc(size_t count, size_t size) noexcept {
+		size_t bytes;
+		if (__builtin_mul_overflow(count, size, &bytes)) {
+			errno = ENOMEM;
+			return nullptr;
+		}
+		const auto p = AllocateOrErrno(bytes);
+		if (p != nullptr) {
+			std::memset(p, 0, bytes);
+		}
+		return p;
+	}
+
+	void* realloc(void* p, size_t size) noexcept {
+		return Reallocate(p, size);
+	}
+
+	void* reallocarray(void* p, size_t count, size_t size) noexcept {
+		size_t bytes;
+		if (__builtin_mul_overflow(count, size, &bytes)) {
+			errno = ENOMEM;
+			return nullptr;
+		}
+		return Reallocate(p, bytes);
+	}
+
+	int posix_memalign(void** out, size_t align, size_t size) noexcept {
+		if (!IsValidAlignment(align) || align % sizeof(void*) != 0) {
+			return EINVAL;
+		}
+		const auto p = Allocate(size, align);
+		if (p == nullptr) {
+			return ENOMEM;
+		}
+		*out = p;
+		return 0;
+	}
+
+	void* aligned_alloc(size_t align, size_t size) noexcept {
+		if (!IsValidAlignment(align)) {
+			errno = EINVAL;
+			return nullptr;
+		}
+		return AllocateOrErrno(size, align);
+	}
+
+	void* memalign(size_t align, size_t size) noexcept {
+		return aligned_alloc(align, size);
+	}
+
+	void* valloc(size_t size) noexcept {
+		return AllocateOrErrno(size, PageSize());
+	}
+
+	void* pvalloc(size_t size) noexcept {
+		if (size > max_request) {
+			errno = ENOMEM;
+			return nullptr;
+		}
+		return AllocateOrErrno((size + PageSize() - 1) & ~(PageSize() - 1), PageSize());
+	}
+
+	size_t malloc_usable_size(void* p) noexcept {
+		return UsableSize(p);
+	}
+}
+
+
+//sized 与 aligned 的 delete 同样由后端查出大小，避免调用方传错
+void* operator new(size_t size) {
+	return AllocateOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+	return AllocateOrThrow(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+	return AllocateOrThrow(size, static_cast<size_t>(align));
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+	return AllocateOrThrow(size, static_cast<size_t>(align));
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	return Allocate(size, static_cast<size_t>(align));
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+	return Allocate(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* p) noexcept {
+	Deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+	Deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	Deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	Deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	Deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	Deallocate(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	Deallocate(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+	Deallocate(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+	Deallocate(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+	Deallocate(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+	Deallocate(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+	Deallocate(p);
+}